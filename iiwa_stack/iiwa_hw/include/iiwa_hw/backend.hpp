@@ -0,0 +1,157 @@
+/**
+ * Copyright (C) 2016 Salvatore Virga - salvo.virga@tum.de, Marco Esposito - marco.esposito@tum.de
+ * Technische Universität München
+ * Chair for Computer Aided Medical Procedures and Augmented Reality
+ * Fakultät für Informatik / I16, Boltzmannstraße 3, 85748 Garching bei München, Germany
+ * http://campar.in.tum.de
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <iiwa_msgs/JointPosition.h>
+#include <iiwa_msgs/JointTorque.h>
+#include <iiwa_msgs/JointVelocity.h>
+#include <iiwa_ros/command/joint_position.hpp>
+#include <iiwa_ros/command/joint_torque.hpp>
+#include <iiwa_ros/command/joint_velocity.hpp>
+#include <iiwa_ros/state/joint_position.hpp>
+#include <iiwa_ros/state/joint_torque.hpp>
+
+#include <cstdint>
+#include <string>
+
+namespace iiwa_hw {
+
+/**
+ * \brief Link of the hardware interface to the robot: joint state samples in, joint commands out.
+ *
+ * All the methods are called from the control loop and must not block; commands and samples hold the seven joints.
+ */
+class Backend {
+public:
+  virtual ~Backend() = default;
+
+  /**
+   * \brief Connects to the robot publishing under the robot_name namespace.
+   */
+  virtual void init(const std::string& robot_name) = 0;
+
+  /**
+   * \brief Returns the latest joint position [rad] and its time stamp.
+   */
+  virtual iiwa_ros::JointSample getPosition() = 0;
+
+  /**
+   * \brief Returns the latest measured joint torque [Nm] and its time stamp.
+   */
+  virtual iiwa_ros::JointSample getTorque() = 0;
+
+  /**
+   * \brief Returns the receive statistics of the joint position and torque streams.
+   */
+  virtual const iiwa_ros::StateStatistics& getPositionStatistics() const = 0;
+  virtual const iiwa_ros::StateStatistics& getTorqueStatistics() const = 0;
+
+  /**
+   * \brief Commands the joint position [rad], velocity [rad/s] or torque [Nm].
+   */
+  virtual void setPosition(const double* position) = 0;
+  virtual void setVelocity(const double* velocity) = 0;
+  virtual void setTorque(const double* torque) = 0;
+};
+
+/**
+ * \brief The robot behind the iiwa_ros state and command topics.
+ */
+class RosBackend : public Backend {
+public:
+  void init(const std::string& robot_name) override;
+
+  iiwa_ros::JointSample getPosition() override { return position_state_.getPositionSample(); }
+  iiwa_ros::JointSample getTorque() override { return torque_state_.getTorqueSample(); }
+
+  const iiwa_ros::StateStatistics& getPositionStatistics() const override { return position_state_.getStatistics(); }
+  const iiwa_ros::StateStatistics& getTorqueStatistics() const override { return torque_state_.getStatistics(); }
+
+  void setPosition(const double* position) override;
+  void setVelocity(const double* velocity) override;
+  void setTorque(const double* torque) override;
+
+private:
+  iiwa_ros::state::JointPosition position_state_{};
+  iiwa_ros::state::JointTorque torque_state_{};
+  iiwa_ros::command::JointPosition position_command_{};
+  iiwa_ros::command::JointVelocity velocity_command_{};
+  iiwa_ros::command::JointTorque torque_command_{};
+
+  iiwa_msgs::JointPosition position_message_{};
+  iiwa_msgs::JointVelocity velocity_message_{};
+  iiwa_msgs::JointTorque torque_message_{};
+};
+
+/**
+ * \brief In-process simulated robot, to run the hardware interface and its controllers at full rate without a robot.
+ *
+ * Every getPosition() advances seven decoupled joints to the current time under the last command: a position command
+ * is tracked with a first-order lag, a velocity command is integrated and a torque drives the joint inertia against
+ * viscous damping. The joint torque sample is the torque that produced the motion.
+ */
+class MockBackend : public Backend {
+public:
+  explicit MockBackend(double inertia = 1.0, double damping = 1.0, double position_time_constant = 0.01);
+
+  void init(const std::string& robot_name) override;
+
+  iiwa_ros::JointSample getPosition() override;
+  iiwa_ros::JointSample getTorque() override { return torque_sample_; }
+
+  const iiwa_ros::StateStatistics& getPositionStatistics() const override { return position_statistics_; }
+  const iiwa_ros::StateStatistics& getTorqueStatistics() const override { return torque_statistics_; }
+
+  void setPosition(const double* position) override;
+  void setVelocity(const double* velocity) override;
+  void setTorque(const double* torque) override;
+
+private:
+  enum class Mode { POSITION, VELOCITY, TORQUE };
+
+  void publish(double stamp);
+
+  double inertia_, damping_, position_time_constant_;
+
+  Mode mode_{Mode::POSITION};
+  double command_[7]{};
+  double q_[7]{};
+  double dq_[7]{};
+  double tau_[7]{};
+  uint32_t sequence_{0};
+
+  iiwa_ros::JointSample position_sample_{};
+  iiwa_ros::JointSample torque_sample_{};
+  iiwa_ros::StateStatistics position_statistics_;
+  iiwa_ros::StateStatistics torque_statistics_;
+};
+
+}  // namespace iiwa_hw
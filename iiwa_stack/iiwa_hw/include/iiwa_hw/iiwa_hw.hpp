@@ -31,11 +31,7 @@
 #pragma once
 
 // iiwa_msgs and ROS inteface includes
-#include <iiwa_msgs/JointPosition.h>
-#include <iiwa_msgs/JointTorque.h>
-#include <iiwa_ros/command/joint_position.hpp>
-#include <iiwa_ros/state/joint_position.hpp>
-#include <iiwa_ros/state/joint_torque.hpp>
+#include "iiwa_hw/backend.hpp"
 
 // ROS headers
 #include <control_toolbox/filters.h>
@@ -50,9 +46,12 @@
 #include <std_msgs/Duration.h>
 #include <urdf/model.h>
 
+#include <memory>
 #include <sstream>
 #include <vector>
 
+#include "iiwa_hw/velocity_estimator.hpp"
+
 constexpr int DEFAULT_CONTROL_FREQUENCY = 1000;  // Hz
 constexpr int IIWA_JOINTS = 7;
 
@@ -71,12 +70,13 @@ public:
   bool init(ros::NodeHandle& root_nh, ros::NodeHandle &robot_hw_nh) override;
 
   /**
-   * \brief Registers the limits of the joint specified by joint_name and joint_handle.
+   * \brief Registers the limits of the joint specified by joint_name, joint_handle (effort) and velocity_handle.
    *
    * The limits are retrieved from the urdf_model.
    * Returns the joint's type, lower position limit, upper position limit, and effort limit.
    */
   void registerJointLimits(const std::string& joint_name, const hardware_interface::JointHandle& joint_handle,
+                           const hardware_interface::JointHandle& velocity_handle,
                            const urdf::Model* const urdf_model, double lower_limit, double upper_limit,
                            double effort_limit);
 
@@ -86,7 +86,7 @@ public:
   void read(const ros::Time& time, const ros::Duration& period) override;
 
   /**
-   * \brief Sends the command joint position to the robot via the interface provided by iiwa_ros.
+   * \brief Sends the joint position, velocity or effort command of the active interface to the robot backend.
    */
   void write(const ros::Time& time, const ros::Duration& period) override;
 
@@ -120,6 +120,7 @@ public:
     std::vector<double> joint_velocity{};
     std::vector<double> joint_effort{};
     std::vector<double> joint_position_command{};
+    std::vector<double> joint_velocity_command{};
     std::vector<double> joint_stiffness_command{};
     std::vector<double> joint_damping_command{};
     std::vector<double> joint_effort_command{};
@@ -130,6 +131,7 @@ public:
       joint_velocity.resize(IIWA_JOINTS);
       joint_effort.resize(IIWA_JOINTS);
       joint_position_command.resize(IIWA_JOINTS);
+      joint_velocity_command.resize(IIWA_JOINTS);
       joint_effort_command.resize(IIWA_JOINTS);
       joint_stiffness_command.resize(IIWA_JOINTS);
       joint_damping_command.resize(IIWA_JOINTS);
@@ -145,6 +147,7 @@ public:
       std::fill(joint_velocity.begin(), joint_velocity.end(), 0);
       std::fill(joint_effort.begin(), joint_effort.end(), 0);
       std::fill(joint_position_command.begin(), joint_position_command.end(), 0);
+      std::fill(joint_velocity_command.begin(), joint_velocity_command.end(), 0);
       std::fill(joint_effort_command.begin(), joint_effort_command.end(), 0);
       std::fill(joint_stiffness_command.begin(), joint_stiffness_command.end(), 0);
       std::fill(joint_damping_command.begin(), joint_damping_command.end(), 0);
@@ -162,12 +165,15 @@ private:
   hardware_interface::JointStateInterface state_interface_;       /**< Interface for joint state */
   hardware_interface::EffortJointInterface effort_interface_;     /**< Interface for joint impedance control */
   hardware_interface::PositionJointInterface position_interface_; /**< Interface for joint position control */
+  hardware_interface::VelocityJointInterface velocity_interface_; /**< Interface for joint velocity control */
 
   /** Interfaces for limits */
   joint_limits_interface::EffortJointSaturationInterface ej_sat_interface_;
   joint_limits_interface::EffortJointSoftLimitsInterface ej_limits_interface_;
   joint_limits_interface::PositionJointSaturationInterface pj_sat_interface_;
   joint_limits_interface::PositionJointSoftLimitsInterface pj_limits_interface_;
+  joint_limits_interface::VelocityJointSaturationInterface vj_sat_interface_;
+  joint_limits_interface::VelocityJointSoftLimitsInterface vj_limits_interface_;
 
   std::shared_ptr<HardwareInterface::Device> device_{nullptr}; /**< IIWA device. */
 
@@ -176,17 +182,15 @@ private:
   ros::Rate loop_rate_{DEFAULT_CONTROL_FREQUENCY};
   double control_frequency_{DEFAULT_CONTROL_FREQUENCY};
 
-  iiwa_ros::state::JointPosition joint_position_state_{};
-  iiwa_ros::state::JointTorque joint_torque_state_{};
-  iiwa_ros::command::JointPosition joint_position_command_{};
+  std::unique_ptr<Backend> backend_{nullptr}; /**< Robot connection, iiwa_ros topics or in-process mock. */
 
-  iiwa_msgs::JointPosition joint_position_{};
-  iiwa_msgs::JointTorque joint_torque_{};
+  iiwa_ros::JointSample joint_position_{};
+  iiwa_ros::JointSample joint_torque_{};
 
-  iiwa_msgs::JointPosition command_joint_position_{};
-  iiwa_msgs::JointTorque command_joint_torque_{};
+  std::unique_ptr<VelocityEstimator> velocity_estimator_{nullptr}; /**< Joint velocity estimation stage. */
 
   std::vector<double> last_joint_position_command_{};
+  bool was_connected_{false}; /**< The position command is seeded from the first joint position received. */
 
   std::vector<std::string> interface_type_{"PositionJointInterface", "EffortJointInterface", "VelocityJointInterface"};
 };
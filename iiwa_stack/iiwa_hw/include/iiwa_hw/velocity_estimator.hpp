@@ -0,0 +1,134 @@
+/**
+ * Copyright (C) 2016 Salvatore Virga - salvo.virga@tum.de, Marco Esposito - marco.esposito@tum.de
+ * Technische Universität München
+ * Chair for Computer Aided Medical Procedures and Augmented Reality
+ * Fakultät für Informatik / I16, Boltzmannstraße 3, 85748 Garching bei München, Germany
+ * http://campar.in.tum.de
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace iiwa_hw {
+
+/**
+ * \brief Estimates joint velocities and accelerations from time-stamped joint position measurements.
+ *
+ * update() is called once per position message with the message time stamp, so the estimate follows the actual
+ * sampling instants instead of the control loop period. All the storage is sized at construction: reset() and
+ * update() never allocate and can run in the real-time loop.
+ */
+class VelocityEstimator {
+public:
+  virtual ~VelocityEstimator() = default;
+
+  /**
+   * \brief Restarts the estimate at rest at the given position.
+   */
+  virtual void reset(const double* position, double stamp) = 0;
+
+  /**
+   * \brief Adds the position measured at stamp [s]. Measurements not newer than the previous one are ignored.
+   */
+  virtual void update(const double* position, double stamp) = 0;
+
+  size_t size() const { return velocity_.size(); }
+  const double* position() const { return position_.data(); }
+  const double* velocity() const { return velocity_.data(); }
+  const double* acceleration() const { return acceleration_.data(); }
+
+protected:
+  explicit VelocityEstimator(size_t joints)
+      : position_(joints, 0.0), velocity_(joints, 0.0), acceleration_(joints, 0.0) {}
+
+  std::vector<double> position_;
+  std::vector<double> velocity_;
+  std::vector<double> acceleration_;
+};
+
+/**
+ * \brief Finite difference of consecutive positions followed by exponential smoothing.
+ *
+ * This is the estimator iiwa_hw always used, with the loop period replaced by the time between the messages. It
+ * lags by roughly (1 - smoothing) / smoothing samples.
+ */
+class FiniteDifferenceEstimator : public VelocityEstimator {
+public:
+  FiniteDifferenceEstimator(size_t joints, double smoothing = 0.2);
+
+  void reset(const double* position, double stamp) override;
+  void update(const double* position, double stamp) override;
+
+private:
+  double smoothing_;
+  double stamp_{0.0};
+};
+
+/**
+ * \brief Per-joint Kalman filter on a constant-acceleration model driven by white jerk.
+ *
+ * jerk_noise is the spectral density of the jerk [rad^2/s^5], position_noise the standard deviation of the position
+ * measurement [rad]. Their ratio sets the bandwidth: a larger jerk_noise follows faster motions with less lag and
+ * more noise.
+ */
+class KalmanEstimator : public VelocityEstimator {
+public:
+  KalmanEstimator(size_t joints, double jerk_noise = 1e3, double position_noise = 1e-4);
+
+  void reset(const double* position, double stamp) override;
+  void update(const double* position, double stamp) override;
+
+private:
+  double jerk_noise_;
+  double position_variance_;
+  double stamp_{0.0};
+  std::vector<double> covariance_;  // upper triangle of the 3x3 covariance of each joint: pp pv pa vv va aa
+};
+
+/**
+ * \brief Causal Savitzky-Golay estimator: quadratic least squares fit of the last window positions, evaluated at the
+ * newest one.
+ *
+ * The fit uses the actual time stamps, so jittery or missing samples are handled exactly. The window must be at least
+ * 3 samples; until it is full the fit uses the samples available and falls back to a line with two samples.
+ */
+class SavitzkyGolayEstimator : public VelocityEstimator {
+public:
+  SavitzkyGolayEstimator(size_t joints, size_t window = 9);
+
+  void reset(const double* position, double stamp) override;
+  void update(const double* position, double stamp) override;
+
+private:
+  size_t window_;
+  size_t count_{0};
+  size_t head_{0};
+  std::vector<double> stamps_;     // ring buffer of the last window stamps
+  std::vector<double> positions_;  // ring buffer of the last window positions, one row of joints per sample
+};
+
+}  // namespace iiwa_hw
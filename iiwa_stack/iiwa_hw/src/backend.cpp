@@ -0,0 +1,141 @@
+/**
+ * Copyright (C) 2016 Salvatore Virga - salvo.virga@tum.de, Marco Esposito - marco.esposito@tum.de
+ * Technische Universität München
+ * Chair for Computer Aided Medical Procedures and Augmented Reality
+ * Fakultät für Informatik / I16, Boltzmannstraße 3, 85748 Garching bei München, Germany
+ * http://campar.in.tum.de
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "iiwa_hw/backend.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace iiwa_hw {
+
+namespace {
+
+void toJointQuantity(const double* values, iiwa_msgs::JointQuantity& quantity) {
+  quantity.a1 = values[0];
+  quantity.a2 = values[1];
+  quantity.a3 = values[2];
+  quantity.a4 = values[3];
+  quantity.a5 = values[4];
+  quantity.a6 = values[5];
+  quantity.a7 = values[6];
+}
+
+}  // namespace
+
+void RosBackend::init(const std::string& robot_name) {
+  position_state_.init(robot_name);
+  torque_state_.init(robot_name);
+  position_command_.init(robot_name);
+  velocity_command_.init(robot_name);
+  torque_command_.init(robot_name);
+}
+
+void RosBackend::setPosition(const double* position) {
+  toJointQuantity(position, position_message_.position);
+  position_message_.header.stamp = ros::Time::now();
+  position_command_.setPosition(position_message_);
+}
+
+void RosBackend::setVelocity(const double* velocity) {
+  toJointQuantity(velocity, velocity_message_.velocity);
+  velocity_message_.header.stamp = ros::Time::now();
+  velocity_command_.setVelocity(velocity_message_);
+}
+
+void RosBackend::setTorque(const double* torque) {
+  toJointQuantity(torque, torque_message_.torque);
+  torque_message_.header.stamp = ros::Time::now();
+  torque_command_.setTorque(torque_message_);
+}
+
+MockBackend::MockBackend(double inertia, double damping, double position_time_constant)
+    : inertia_(inertia), damping_(damping), position_time_constant_(position_time_constant) {}
+
+void MockBackend::init(const std::string& /*robot_name*/) {
+  // The robot is there from the start, at rest at the zero position.
+  publish(ros::Time::now().toSec());
+}
+
+iiwa_ros::JointSample MockBackend::getPosition() {
+  double now = ros::Time::now().toSec();
+  // A stalled loop does not make the integration blow up.
+  double dt = std::min(now - position_sample_.stamp, 0.1);
+  if (dt <= 0.0) { return position_sample_; }
+
+  double blend = 1.0 - std::exp(-dt / position_time_constant_);
+  for (size_t j = 0; j < 7; j++) {
+    double previous_velocity = dq_[j];
+    switch (mode_) {
+      case Mode::POSITION: {
+        double position = q_[j] + (command_[j] - q_[j]) * blend;
+        dq_[j] = (position - q_[j]) / dt;
+        q_[j] = position;
+        break;
+      }
+      case Mode::VELOCITY:
+        dq_[j] = command_[j];
+        q_[j] += dq_[j] * dt;
+        break;
+      case Mode::TORQUE:
+        dq_[j] += dt * (command_[j] - damping_ * dq_[j]) / inertia_;
+        q_[j] += dq_[j] * dt;
+        break;
+    }
+    tau_[j] = inertia_ * (dq_[j] - previous_velocity) / dt + damping_ * dq_[j];
+  }
+  publish(now);
+  return position_sample_;
+}
+
+void MockBackend::setPosition(const double* position) {
+  mode_ = Mode::POSITION;
+  std::copy(position, position + 7, command_);
+}
+
+void MockBackend::setVelocity(const double* velocity) {
+  mode_ = Mode::VELOCITY;
+  std::copy(velocity, velocity + 7, command_);
+}
+
+void MockBackend::setTorque(const double* torque) {
+  mode_ = Mode::TORQUE;
+  std::copy(torque, torque + 7, command_);
+}
+
+void MockBackend::publish(double stamp) {
+  std::copy(q_, q_ + 7, position_sample_.value);
+  std::copy(tau_, tau_ + 7, torque_sample_.value);
+  position_sample_.stamp = torque_sample_.stamp = stamp;
+  sequence_++;
+  position_statistics_.update(true, sequence_);
+  torque_statistics_.update(true, sequence_);
+}
+
+}  // namespace iiwa_hw
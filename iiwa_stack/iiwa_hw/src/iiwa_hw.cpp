@@ -31,7 +31,7 @@
 #include <pluginlib/class_list_macros.hpp>
 
 #include "iiwa_hw/iiwa_hw.hpp"
-#include <iiwa_ros/conversions.hpp>
+#include <algorithm>
 
 namespace iiwa_hw {
 
@@ -50,10 +50,26 @@ bool HardwareInterface::init(ros::NodeHandle& /*unused*/, ros::NodeHandle &robot
   robot_hw_nh.param("hardware_interface", interface_, std::string("PositionJointInterface"));
   robot_hw_nh.param("robot_name", robot_name_, std::string("iiwa"));
 
-  // Initialize Publishers and Subscribers from iiwa_ros.
-  joint_position_state_.init(robot_name_);
-  joint_torque_state_.init(robot_name_);
-  joint_position_command_.init(robot_name_);
+  // Connect to the robot: the iiwa_ros topics, or an in-process simulated robot.
+  std::string backend;
+  robot_hw_nh.param("backend", backend, std::string("ros"));
+
+  // The Sunrise application only applies joint position and velocity commands, torques need a bridge that does.
+  bool torque_bridge;
+  robot_hw_nh.param("torque_bridge", torque_bridge, false);
+  if (interface_ == interface_type_.at(1) && backend != "mock" && !torque_bridge) {
+    ROS_ERROR("The robot does not apply the joint torque commands of the EffortJointInterface, set torque_bridge to "
+              "true if a torque-capable bridge is subscribed to command/JointTorque.");
+    throw std::runtime_error("No torque-capable bridge");
+  }
+
+  if (backend == "mock") {
+    ROS_INFO("Using the in-process mock robot.");
+    backend_.reset(new MockBackend());
+  } else {
+    backend_.reset(new RosBackend());
+  }
+  backend_->init(robot_name_);
 
   if (ros::param::get("joints", device_->joint_names)) {
     if (!(device_->joint_names.size() == IIWA_JOINTS)) {
@@ -70,6 +86,46 @@ bool HardwareInterface::init(ros::NodeHandle& /*unused*/, ros::NodeHandle &robot
     throw std::runtime_error("No URDF model available");
   }
 
+  // Joint velocity estimation from the time-stamped position messages.
+  std::string estimator;
+  robot_hw_nh.param("velocity_estimator/type", estimator, std::string("finite_difference"));
+  if (estimator == "kalman") {
+    double jerk_noise, position_noise;
+    robot_hw_nh.param("velocity_estimator/jerk_noise", jerk_noise, 1e3);
+    robot_hw_nh.param("velocity_estimator/position_noise", position_noise, 1e-4);
+    if (!(jerk_noise > 0.0)) {
+      ROS_WARN_STREAM("velocity_estimator/jerk_noise must be positive, got " << jerk_noise << ", using 1e3.");
+      jerk_noise = 1e3;
+    }
+    if (!(position_noise > 0.0)) {
+      ROS_WARN_STREAM("velocity_estimator/position_noise must be positive, got " << position_noise
+                                                                                << ", using 1e-4.");
+      position_noise = 1e-4;
+    }
+    velocity_estimator_.reset(new KalmanEstimator(IIWA_JOINTS, jerk_noise, position_noise));
+  } else if (estimator == "savitzky_golay") {
+    int window;
+    robot_hw_nh.param("velocity_estimator/window", window, 9);
+    if (window < 3) {
+      ROS_WARN_STREAM("velocity_estimator/window must be at least 3 samples, got " << window << ", using 3.");
+      window = 3;
+    }
+    velocity_estimator_.reset(new SavitzkyGolayEstimator(IIWA_JOINTS, window));
+  } else {
+    if (estimator != "finite_difference") {
+      ROS_WARN_STREAM("Unknown velocity estimator " << estimator << ", using finite_difference.");
+      estimator = "finite_difference";
+    }
+    double smoothing;
+    robot_hw_nh.param("velocity_estimator/smoothing", smoothing, 0.2);
+    if (!(smoothing > 0.0 && smoothing <= 1.0)) {
+      ROS_WARN_STREAM("velocity_estimator/smoothing must be in (0, 1], got " << smoothing << ", using 0.2.");
+      smoothing = 0.2;
+    }
+    velocity_estimator_.reset(new FiniteDifferenceEstimator(IIWA_JOINTS, smoothing));
+  }
+  ROS_INFO_STREAM("Joint velocity estimator: " << estimator);
+
   // Initialize and set to zero the state and command values.
   device_->init();
   device_->reset();
@@ -104,8 +160,14 @@ bool HardwareInterface::init(ros::NodeHandle& /*unused*/, ros::NodeHandle &robot
         state_interface_.getHandle(device_->joint_names[i]), &device_->joint_effort_command[i]);
     effort_interface_.registerHandle(joint_handle);
 
-    registerJointLimits(device_->joint_names[i], joint_handle, &urdf_model_, device_->joint_lower_limits[i],
-                        device_->joint_upper_limits[i], device_->joint_effort_limits[i]);
+    // Velocity command handle.
+    hardware_interface::JointHandle velocity_joint_handle = hardware_interface::JointHandle(
+        state_interface_.getHandle(device_->joint_names[i]), &device_->joint_velocity_command[i]);
+    velocity_interface_.registerHandle(velocity_joint_handle);
+
+    registerJointLimits(device_->joint_names[i], joint_handle, velocity_joint_handle, &urdf_model_,
+                        device_->joint_lower_limits[i], device_->joint_upper_limits[i],
+                        device_->joint_effort_limits[i]);
   }
 
   ROS_INFO("Registering state and effort interfaces");
@@ -114,12 +176,14 @@ bool HardwareInterface::init(ros::NodeHandle& /*unused*/, ros::NodeHandle &robot
   this->registerInterface(&state_interface_);
   this->registerInterface(&effort_interface_);
   this->registerInterface(&position_interface_);
+  this->registerInterface(&velocity_interface_);
 
   return true;
 }
 
 void HardwareInterface::registerJointLimits(const std::string& joint_name,
                                             const hardware_interface::JointHandle& joint_handle,
+                                            const hardware_interface::JointHandle& velocity_handle,
                                             const urdf::Model* const urdf_model, double lower_limit, double upper_limit,
                                             double effort_limit) {
   lower_limit = -std::numeric_limits<double>::max();
@@ -159,36 +223,53 @@ void HardwareInterface::registerJointLimits(const std::string& joint_name,
     const joint_limits_interface::EffortJointSaturationHandle sat_handle(joint_handle, limits);
     ej_sat_interface_.registerHandle(sat_handle);
   }
+
+  if (!limits.has_velocity_limits) { return; }
+
+  if (has_soft_limits) {
+    const joint_limits_interface::VelocityJointSoftLimitsHandle limits_handle(velocity_handle, limits, soft_limits);
+    vj_limits_interface_.registerHandle(limits_handle);
+  }
+  else
+  {
+    const joint_limits_interface::VelocityJointSaturationHandle sat_handle(velocity_handle, limits);
+    vj_sat_interface_.registerHandle(sat_handle);
+  }
 }
 
 void HardwareInterface::read(const ros::Time& time, const ros::Duration& period) {
   ros::Duration delta = ros::Time::now() - timer_;
 
-  static bool was_connected = false;
-
-  if (joint_position_state_.isConnected()) {
-    joint_position_ = joint_position_state_.getPosition();
-    joint_torque_ = joint_torque_state_.getTorque();
+  // wait-free reads, the subscriber callbacks never block the control loop; the mock robot advances here
+  joint_position_ = backend_->getPosition();
 
+  if (backend_->getPositionStatistics().isConnected()) {
     device_->joint_position_prev = device_->joint_position;
+    std::copy(joint_position_.value, joint_position_.value + IIWA_JOINTS, device_->joint_position.begin());
+
+    // each stream is checked on its own, a stale torque feed keeps the last torque
+    if (backend_->getTorqueStatistics().isConnected()) {
+      joint_torque_ = backend_->getTorque();
+      std::copy(joint_torque_.value, joint_torque_.value + IIWA_JOINTS, device_->joint_effort.begin());
+    } else {
+      ROS_WARN_THROTTLE(1.0, "Joint torque state is stale (%.3f s old), keeping the last torque.",
+                        backend_->getTorqueStatistics().age());
+    }
 
-    auto current_joint_position = iiwa_ros::conversions::jointQuantityToVector<double>(joint_position_.position);
-    device_->joint_position = current_joint_position;
-
-    auto current_joint_torque = iiwa_ros::conversions::jointQuantityToVector<double>(joint_torque_.torque);
-    device_->joint_effort = current_joint_torque;
+    // messages without a stamp fall back to the loop time
+    double stamp = joint_position_.stamp > 0.0 ? joint_position_.stamp : time.toSec();
 
     // if there is no controller active the robot goes to zero position
-    if (!was_connected) {
+    if (!was_connected_) {
       for (size_t j = 0; j < IIWA_JOINTS; j++) { device_->joint_position_command[j] = device_->joint_position[j]; }
-      was_connected = true;
+      velocity_estimator_->reset(joint_position_.value, stamp);
+      was_connected_ = true;
     }
 
-    for (size_t j = 0; j < IIWA_JOINTS; j++) {
-      device_->joint_velocity[j] =
-          filters::exponentialSmoothing((device_->joint_position[j] - device_->joint_position_prev[j]) / period.toSec(),
-                                        device_->joint_velocity[j], 0.2);
-    }
+    // only a new position message advances the estimate, loop ticks without one keep it
+    velocity_estimator_->update(joint_position_.value, stamp);
+    std::copy(velocity_estimator_->velocity(), velocity_estimator_->velocity() + IIWA_JOINTS,
+              device_->joint_velocity.begin());
   } else if (delta.toSec() >= 10) {
     ROS_INFO("No LBR IIWA is connected. Waiting for the robot to connect before reading ...");
     timer_ = ros::Time::now();
@@ -200,11 +281,13 @@ void HardwareInterface::write(const ros::Time &time, const ros::Duration &period
   ej_limits_interface_.enforceLimits(period);
   pj_sat_interface_.enforceLimits(period);
   pj_limits_interface_.enforceLimits(period);
+  vj_sat_interface_.enforceLimits(period);
+  vj_limits_interface_.enforceLimits(period);
 
   ros::Duration delta = ros::Time::now() - timer_;
 
   // Reading the joint values.
-  if (joint_position_state_.isConnected()) {
+  if (backend_->getPositionStatistics().isConnected()) {
     // Joint Position Control.
     if (interface_ == interface_type_.at(0)) {
       // Avoid sending the same joint command over and over.
@@ -212,20 +295,15 @@ void HardwareInterface::write(const ros::Time &time, const ros::Duration &period
 
       last_joint_position_command_ = device_->joint_position_command;
 
-      // Building the message
-      auto command = iiwa_ros::conversions::jointQuantityFromVector<double>(device_->joint_position_command);
-      command_joint_position_.position = command;
-      command_joint_position_.header.stamp = ros::Time::now();
-
-      joint_position_command_.setPosition(command_joint_position_);
+      backend_->setPosition(device_->joint_position_command.data());
     }
-    // Joint Impedance Control.
+    // Joint Torque Control, streamed every cycle.
     else if (interface_ == interface_type_.at(1)) {
-      // TODO
+      backend_->setTorque(device_->joint_effort_command.data());
     }
-    // Joint Velocity Control.
+    // Joint Velocity Control, streamed every cycle.
     else if (interface_ == interface_type_.at(2)) {
-      // TODO
+      backend_->setVelocity(device_->joint_velocity_command.data());
     }
   } else if (delta.toSec() >= 10) {
     ROS_INFO_STREAM("No LBR IIWA is connected. Waiting for the robot to connect before writing ...");
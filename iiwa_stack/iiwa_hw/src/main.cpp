@@ -29,7 +29,19 @@
  */
 
 #include <ros/ros.h>
+#include <algorithm>
+#include <cerrno>
 #include <csignal>
+#include <cstdint>
+#include <cstring>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include <iiwa_msgs/LoopTiming.h>
+#include <realtime_tools/realtime_publisher.h>
 
 #include "iiwa_hw/iiwa_hw.hpp"
 
@@ -37,6 +49,76 @@ static bool quit{false};
 
 void signalHandler(int /*unused*/) { quit = true; }
 
+namespace {
+
+constexpr int64_t NSEC_PER_SEC = 1000000000;
+
+int64_t monotonicNow() {
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return static_cast<int64_t>(t.tv_sec) * NSEC_PER_SEC + t.tv_nsec;
+}
+
+/** Cycle timing, cumulative counters and extrema over the current reporting window. */
+struct LoopStatistics {
+  uint64_t cycles{0};
+  uint64_t overruns{0};
+
+  uint64_t window_cycles{0};
+  double latency_sum{0.0}, latency_max{0.0};
+  double period_min{0.0}, period_max{0.0};
+  double compute_sum{0.0}, compute_max{0.0};
+
+  void add(double latency, double period, double compute) {
+    cycles++;
+    window_cycles++;
+    latency_sum += latency;
+    latency_max = std::max(latency_max, latency);
+    period_min = window_cycles == 1 ? period : std::min(period_min, period);
+    period_max = std::max(period_max, period);
+    compute_sum += compute;
+    compute_max = std::max(compute_max, compute);
+  }
+
+  void resetWindow() {
+    window_cycles = 0;
+    latency_sum = latency_max = period_min = period_max = compute_sum = compute_max = 0.0;
+  }
+};
+
+/**
+ * Locks the process memory, pins the calling thread to cpu and moves it to SCHED_FIFO at priority; cpu < 0 or
+ * priority <= 0 skip the respective step. Failures (e.g. missing rtprio limits) are reported and the loop runs anyway.
+ */
+void setupRealtime(bool lock_memory, int cpu, int priority) {
+  if (lock_memory) {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+      ROS_WARN("mlockall failed: %s", std::strerror(errno));
+    } else {
+      // Prefault some stack so the first cycles do not page fault.
+      volatile unsigned char stack[64 * 1024];
+      for (size_t i = 0; i < sizeof(stack); i += 4096) { stack[i] = 0; }
+    }
+  }
+
+  if (cpu >= 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (error != 0) { ROS_WARN("Cannot pin the control loop to CPU %d: %s", cpu, std::strerror(error)); }
+  }
+
+  if (priority > 0) {
+    sched_param param;
+    param.sched_priority = priority;
+    int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (error != 0) { ROS_WARN("Cannot set SCHED_FIFO priority %d: %s", priority, std::strerror(error)); }
+  }
+}
+
+}  // namespace
+
 int main(int argc, char** argv) {
   // Initialize ROS.
   ros::init(argc, argv, "iiwa_hw", ros::init_options::NoSigintHandler);
@@ -57,6 +139,14 @@ int main(int argc, char** argv) {
   // Configuration routines.
   iiwa_robot.init(iiwa_nh, iiwa_nh);
 
+  // Real-time execution: absolute monotonic deadlines, optional memory locking, CPU pinning and SCHED_FIFO.
+  bool realtime, lock_memory;
+  int cpu, priority;
+  iiwa_nh.param("realtime/enabled", realtime, false);
+  iiwa_nh.param("realtime/lock_memory", lock_memory, true);
+  iiwa_nh.param("realtime/cpu", cpu, -1);
+  iiwa_nh.param("realtime/priority", priority, 80);
+
   ros::Time last(ros::Time::now());
   ros::Time now;
   ros::Duration period(1.0);
@@ -64,12 +154,42 @@ int main(int argc, char** argv) {
   // Controller manager.
   controller_manager::ControllerManager manager(&iiwa_robot, iiwa_nh);
 
-  // Run as fast as possible.
+  // Loop timing, published once per second without blocking the loop.
+  realtime_tools::RealtimePublisher<iiwa_msgs::LoopTiming> timing_publisher(iiwa_nh, "iiwa_hw/loop_timing", 1);
+  LoopStatistics statistics;
+
+  // Everything allocated so far stays resident; the spinner and publisher threads keep the default scheduling.
+  if (realtime) {
+    setupRealtime(lock_memory, cpu, priority);
+    ROS_INFO("Running the control loop in real-time mode at %g Hz.", iiwa_robot.getFrequency());
+  }
+
+  const int64_t period_ns = static_cast<int64_t>(NSEC_PER_SEC / iiwa_robot.getFrequency());
+  int64_t last_start = monotonicNow();
+  int64_t deadline = last_start + period_ns;
+  int64_t last_report = last_start;
+
+  // getRate() returns a copy: keep one across cycles, so that it tracks its own deadlines
+  ros::Rate rate = iiwa_robot.getRate();
+
+  // Run at the control frequency.
   while (!quit) {
+    // wait for the next deadline; without real-time mode ros::Rate keeps the (possibly simulated) ROS time and
+    // reports the cycles that missed its deadline (the first one starts from a stale deadline)
+    bool missed = false;
+    if (realtime) {
+      timespec wakeup;
+      wakeup.tv_sec = deadline / NSEC_PER_SEC;
+      wakeup.tv_nsec = deadline % NSEC_PER_SEC;
+      while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, nullptr) == EINTR && !quit) {}
+    } else {
+      missed = !rate.sleep() && statistics.cycles > 0;
+    }
+    int64_t start = monotonicNow();
 
     // Get the time / period.
     now = ros::Time::now();
-    period = now - last;
+    period = realtime ? ros::Duration((start - last_start) * 1e-9) : now - last;
     last = now;
 
     // Read current robot position.
@@ -81,8 +201,40 @@ int main(int argc, char** argv) {
     // send command position to the robot
     iiwa_robot.write(now, period);
 
-    // wait for some milliseconds defined in controlFrequency
-    iiwa_robot.getRate().sleep();
+    int64_t end = monotonicNow();
+    if (realtime) {
+      statistics.add(std::max<int64_t>(start - deadline, 0) * 1e-9, (start - last_start) * 1e-9,
+                     (end - start) * 1e-9);
+
+      // A cycle that ends after the next deadline is an overrun, the deadlines it missed are skipped.
+      deadline += period_ns;
+      if (end > deadline) {
+        statistics.overruns++;
+        deadline += ((end - deadline) / period_ns + 1) * period_ns;
+      }
+    } else {
+      // No monotonic deadlines to measure the wake-up latency against: period and overruns in ROS time.
+      statistics.add(0.0, period.toSec(), (end - start) * 1e-9);
+      if (missed) { statistics.overruns++; }
+    }
+    last_start = start;
+
+    if (end - last_report >= NSEC_PER_SEC && timing_publisher.trylock()) {
+      iiwa_msgs::LoopTiming& timing = timing_publisher.msg_;
+      timing.header.stamp = now;
+      timing.period = period_ns * 1e-9;
+      timing.cycles = statistics.cycles;
+      timing.overruns = statistics.overruns;
+      timing.latency_mean = statistics.latency_sum / statistics.window_cycles;
+      timing.latency_max = statistics.latency_max;
+      timing.period_min = statistics.period_min;
+      timing.period_max = statistics.period_max;
+      timing.compute_mean = statistics.compute_sum / statistics.window_cycles;
+      timing.compute_max = statistics.compute_max;
+      timing_publisher.unlockAndPublish();
+      statistics.resetWindow();
+      last_report = end;
+    }
   }
 
   spinner.stop();
@@ -0,0 +1,204 @@
+/**
+ * Copyright (C) 2016 Salvatore Virga - salvo.virga@tum.de, Marco Esposito - marco.esposito@tum.de
+ * Technische Universität München
+ * Chair for Computer Aided Medical Procedures and Augmented Reality
+ * Fakultät für Informatik / I16, Boltzmannstraße 3, 85748 Garching bei München, Germany
+ * http://campar.in.tum.de
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "iiwa_hw/velocity_estimator.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace iiwa_hw {
+
+FiniteDifferenceEstimator::FiniteDifferenceEstimator(size_t joints, double smoothing)
+    : VelocityEstimator(joints), smoothing_(smoothing) {}
+
+void FiniteDifferenceEstimator::reset(const double* position, double stamp) {
+  std::copy(position, position + size(), position_.begin());
+  std::fill(velocity_.begin(), velocity_.end(), 0.0);
+  std::fill(acceleration_.begin(), acceleration_.end(), 0.0);
+  stamp_ = stamp;
+}
+
+void FiniteDifferenceEstimator::update(const double* position, double stamp) {
+  double dt = stamp - stamp_;
+  if (dt <= 0.0) { return; }
+
+  for (size_t j = 0; j < size(); j++) {
+    double velocity = smoothing_ * (position[j] - position_[j]) / dt + (1.0 - smoothing_) * velocity_[j];
+    acceleration_[j] = smoothing_ * (velocity - velocity_[j]) / dt + (1.0 - smoothing_) * acceleration_[j];
+    velocity_[j] = velocity;
+    position_[j] = position[j];
+  }
+  stamp_ = stamp;
+}
+
+KalmanEstimator::KalmanEstimator(size_t joints, double jerk_noise, double position_noise)
+    : VelocityEstimator(joints),
+      jerk_noise_(jerk_noise),
+      position_variance_(position_noise * position_noise),
+      covariance_(6 * joints, 0.0) {}
+
+void KalmanEstimator::reset(const double* position, double stamp) {
+  std::copy(position, position + size(), position_.begin());
+  std::fill(velocity_.begin(), velocity_.end(), 0.0);
+  std::fill(acceleration_.begin(), acceleration_.end(), 0.0);
+
+  // Known position, loosely known rest.
+  for (size_t j = 0; j < size(); j++) {
+    double* p = &covariance_[6 * j];
+    p[0] = position_variance_;
+    p[1] = p[2] = p[4] = 0.0;
+    p[3] = 1.0;
+    p[5] = 100.0;
+  }
+  stamp_ = stamp;
+}
+
+void KalmanEstimator::update(const double* position, double stamp) {
+  double dt = stamp - stamp_;
+  if (dt <= 0.0) { return; }
+  stamp_ = stamp;
+
+  // Discretized white-jerk process noise, shared by all the joints.
+  double dt2 = dt * dt, dt3 = dt2 * dt;
+  double h = 0.5 * dt2;
+  double q_pp = jerk_noise_ * dt3 * dt2 / 20.0, q_pv = jerk_noise_ * dt2 * dt2 / 8.0, q_pa = jerk_noise_ * dt3 / 6.0;
+  double q_vv = jerk_noise_ * dt3 / 3.0, q_va = jerk_noise_ * dt2 / 2.0, q_aa = jerk_noise_ * dt;
+
+  for (size_t j = 0; j < size(); j++) {
+    double* p = &covariance_[6 * j];
+    double pp = p[0], pv = p[1], pa = p[2], vv = p[3], va = p[4], aa = p[5];
+
+    // Prediction: x = F*x, P = F*P*F' + Q, F = [1 dt dt^2/2; 0 1 dt; 0 0 1].
+    double x_p = position_[j] + dt * velocity_[j] + h * acceleration_[j];
+    double x_v = velocity_[j] + dt * acceleration_[j];
+    double x_a = acceleration_[j];
+
+    double r00 = pp + dt * pv + h * pa, r01 = pv + dt * vv + h * va, r02 = pa + dt * va + h * aa;
+    double r11 = vv + dt * va, r12 = va + dt * aa;
+    pp = r00 + dt * r01 + h * r02 + q_pp;
+    pv = r01 + dt * r02 + q_pv;
+    pa = r02 + q_pa;
+    vv = r11 + dt * r12 + q_vv;
+    va = r12 + q_va;
+    aa = aa + q_aa;
+
+    // Correction with the measured position.
+    double s = pp + position_variance_;
+    double k_p = pp / s, k_v = pv / s, k_a = pa / s;
+    double innovation = position[j] - x_p;
+    position_[j] = x_p + k_p * innovation;
+    velocity_[j] = x_v + k_v * innovation;
+    acceleration_[j] = x_a + k_a * innovation;
+
+    p[0] = pp - k_p * pp;
+    p[1] = pv - k_p * pv;
+    p[2] = pa - k_p * pa;
+    p[3] = vv - k_v * pv;
+    p[4] = va - k_v * pa;
+    p[5] = aa - k_a * pa;
+  }
+}
+
+SavitzkyGolayEstimator::SavitzkyGolayEstimator(size_t joints, size_t window)
+    : VelocityEstimator(joints),
+      window_(std::max<size_t>(window, 3)),
+      stamps_(window_, 0.0),
+      positions_(window_ * joints, 0.0) {}
+
+void SavitzkyGolayEstimator::reset(const double* position, double stamp) {
+  std::copy(position, position + size(), position_.begin());
+  std::fill(velocity_.begin(), velocity_.end(), 0.0);
+  std::fill(acceleration_.begin(), acceleration_.end(), 0.0);
+
+  count_ = 0;
+  head_ = 0;
+  update(position, stamp);
+}
+
+void SavitzkyGolayEstimator::update(const double* position, double stamp) {
+  size_t newest = (head_ + window_ - 1) % window_;
+  if (count_ > 0 && stamp <= stamps_[newest]) { return; }
+
+  stamps_[head_] = stamp;
+  std::copy(position, position + size(), positions_.begin() + head_ * size());
+  newest = head_;
+  head_ = (head_ + 1) % window_;
+  count_ = std::min(count_ + 1, window_);
+  std::copy(position, position + size(), position_.begin());
+  if (count_ < 2) { return; }
+
+  // Fit p(t) - p(t_newest) = c0 + c1*u + c2*u^2 with u = (t - t_newest)/span, span scaling keeps the normal
+  // equations well conditioned. The moments only depend on the stamps, so they are shared by all the joints.
+  size_t oldest = (head_ + window_ - count_) % window_;
+  double span = stamp - stamps_[oldest];
+  double m0 = 0.0, m1 = 0.0, m2 = 0.0, m3 = 0.0, m4 = 0.0;
+  for (size_t k = 0; k < count_; k++) {
+    double u = (stamps_[(oldest + k) % window_] - stamp) / span;
+    double u2 = u * u;
+    m0 += 1.0;
+    m1 += u;
+    m2 += u2;
+    m3 += u2 * u;
+    m4 += u2 * u2;
+  }
+
+  // Rows of the inverse of the normal matrix that give c1 and c2; a line if the quadratic is not determined.
+  double i10, i11, i12, i20, i21, i22;
+  double det = m0 * (m2 * m4 - m3 * m3) - m1 * (m1 * m4 - m2 * m3) + m2 * (m1 * m3 - m2 * m2);
+  if (count_ >= 3 && std::fabs(det) > 1e-12) {
+    i10 = (m2 * m3 - m1 * m4) / det;
+    i11 = (m0 * m4 - m2 * m2) / det;
+    i12 = (m1 * m2 - m0 * m3) / det;
+    i20 = (m1 * m3 - m2 * m2) / det;
+    i21 = (m1 * m2 - m0 * m3) / det;
+    i22 = (m0 * m2 - m1 * m1) / det;
+  } else {
+    double det2 = m0 * m2 - m1 * m1;
+    i10 = -m1 / det2;
+    i11 = m0 / det2;
+    i12 = i20 = i21 = i22 = 0.0;
+  }
+
+  for (size_t j = 0; j < size(); j++) {
+    double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+    for (size_t k = 0; k < count_; k++) {
+      size_t i = (oldest + k) % window_;
+      double u = (stamps_[i] - stamp) / span;
+      double dp = positions_[i * size() + j] - positions_[newest * size() + j];
+      b0 += dp;
+      b1 += u * dp;
+      b2 += u * u * dp;
+    }
+    velocity_[j] = (i10 * b0 + i11 * b1 + i12 * b2) / span;
+    acceleration_[j] = 2.0 * (i20 * b0 + i21 * b1 + i22 * b2) / (span * span);
+  }
+}
+
+}  // namespace iiwa_hw
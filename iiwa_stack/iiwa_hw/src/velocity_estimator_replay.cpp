@@ -0,0 +1,218 @@
+/**
+ * Copyright (C) 2016 Salvatore Virga - salvo.virga@tum.de, Marco Esposito - marco.esposito@tum.de
+ * Technische Universität München
+ * Chair for Computer Aided Medical Procedures and Augmented Reality
+ * Fakultät für Informatik / I16, Boltzmannstraße 3, 85748 Garching bei München, Germany
+ * http://campar.in.tum.de
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Offline comparison of the joint velocity estimators: replays the joint positions of a bag (iiwa_msgs/JointPosition
+// or sensor_msgs/JointState) or of a synthetic trajectory through every estimator, and reports the RMS error, the lag
+// that best aligns the estimate with the reference, the noise left at that lag and the cost of update().
+// The reference velocity is the exact one for the synthetic trajectory, a zero-phase central difference for a bag.
+//
+// Usage: velocity_estimator_replay <bag> [topic, default /iiwa/state/JointPosition]
+//        velocity_estimator_replay --synthetic [position noise rad, default 1e-5] [stamp jitter s, default 1e-4]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <iiwa_msgs/JointPosition.h>
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+#include <sensor_msgs/JointState.h>
+
+#include "iiwa_hw/velocity_estimator.hpp"
+
+namespace {
+
+constexpr size_t JOINTS = 7;
+
+struct Recording {
+  std::vector<double> stamps;
+  std::vector<double> positions;   // JOINTS per sample
+  std::vector<double> velocities;  // reference, JOINTS per sample
+};
+
+bool loadBag(const std::string& path, const std::string& topic, Recording& recording) {
+  rosbag::Bag bag;
+  try {
+    bag.open(path, rosbag::bagmode::Read);
+  } catch (const rosbag::BagException& e) {
+    std::fprintf(stderr, "Cannot open %s: %s\n", path.c_str(), e.what());
+    return false;
+  }
+
+  for (const rosbag::MessageInstance& message : rosbag::View(bag, rosbag::TopicQuery(topic))) {
+    double q[JOINTS];
+    ros::Time stamp;
+    if (auto position = message.instantiate<iiwa_msgs::JointPosition>()) {
+      const auto& p = position->position;
+      double values[JOINTS] = {p.a1, p.a2, p.a3, p.a4, p.a5, p.a6, p.a7};
+      std::copy(values, values + JOINTS, q);
+      stamp = position->header.stamp;
+    } else if (auto state = message.instantiate<sensor_msgs::JointState>()) {
+      if (state->position.size() < JOINTS) { continue; }
+      std::copy(state->position.begin(), state->position.begin() + JOINTS, q);
+      stamp = state->header.stamp;
+    } else {
+      continue;
+    }
+    // Messages without a stamp fall back to the recording time.
+    recording.stamps.push_back(stamp.isZero() ? message.getTime().toSec() : stamp.toSec());
+    recording.positions.insert(recording.positions.end(), q, q + JOINTS);
+  }
+  bag.close();
+
+  if (recording.stamps.size() < 20) {
+    std::fprintf(stderr, "%s has %zu joint position messages on %s, not enough to compare the estimators\n",
+                 path.c_str(), recording.stamps.size(), topic.c_str());
+    return false;
+  }
+
+  // Zero-phase reference: central difference over +-5 samples.
+  const size_t k = 5, n = recording.stamps.size();
+  recording.velocities.assign(n * JOINTS, 0.0);
+  for (size_t i = k; i + k < n; i++) {
+    double dt = recording.stamps[i + k] - recording.stamps[i - k];
+    for (size_t j = 0; j < JOINTS; j++) {
+      recording.velocities[i * JOINTS + j] =
+          (recording.positions[(i + k) * JOINTS + j] - recording.positions[(i - k) * JOINTS + j]) / dt;
+    }
+  }
+  return true;
+}
+
+// 10 s of a sum of two sines per joint at 1 kHz, with jittered stamps and position noise.
+void synthesize(double noise, double jitter, Recording& recording) {
+  std::mt19937 generator(42);
+  std::normal_distribution<double> position_noise(0.0, noise);
+  std::uniform_real_distribution<double> stamp_jitter(-jitter, jitter);
+
+  const double rate = 1000.0, duration = 10.0;
+  for (size_t i = 0; i < rate * duration; i++) {
+    double t = i / rate;
+    double stamp = t + stamp_jitter(generator);
+    recording.stamps.push_back(stamp);
+    for (size_t j = 0; j < JOINTS; j++) {
+      double w1 = 2.0 * M_PI * (0.2 + 0.1 * j), w2 = 2.0 * M_PI * (1.5 + 0.3 * j);
+      recording.positions.push_back(0.5 * std::sin(w1 * t) + 0.05 * std::sin(w2 * t) + position_noise(generator));
+      recording.velocities.push_back(0.5 * w1 * std::cos(w1 * t) + 0.05 * w2 * std::cos(w2 * t));
+    }
+  }
+  // The estimators see the jittered stamps while the truth is sampled on the nominal grid, as with a real clock.
+}
+
+void evaluate(const char* name, iiwa_hw::VelocityEstimator& estimator, const Recording& recording) {
+  const size_t n = recording.stamps.size();
+  std::vector<double> estimate(n * JOINTS, 0.0);
+  double total_ns = 0.0, max_ns = 0.0;
+
+  estimator.reset(&recording.positions[0], recording.stamps[0]);
+  for (size_t i = 1; i < n; i++) {
+    auto t0 = std::chrono::steady_clock::now();
+    estimator.update(&recording.positions[i * JOINTS], recording.stamps[i]);
+    auto t1 = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+    total_ns += ns;
+    max_ns = std::max(max_ns, ns);
+    std::copy(estimator.velocity(), estimator.velocity() + JOINTS, estimate.begin() + i * JOINTS);
+  }
+
+  // RMS difference between the estimate and the reference delayed by shift samples, after a settling second.
+  const size_t skip = std::min<size_t>(n / 4, 1000), max_shift = 100;
+  auto rms = [&](size_t shift) {
+    double sum = 0.0;
+    size_t count = 0;
+    for (size_t i = skip + max_shift; i + 5 < n; i++) {
+      for (size_t j = 0; j < JOINTS; j++) {
+        double e = estimate[i * JOINTS + j] - recording.velocities[(i - shift) * JOINTS + j];
+        sum += e * e;
+        count++;
+      }
+    }
+    return std::sqrt(sum / count);
+  };
+
+  size_t lag = 0;
+  double best = rms(0);
+  for (size_t shift = 1; shift <= max_shift; shift++) {
+    double value = rms(shift);
+    if (value < best) {
+      best = value;
+      lag = shift;
+    }
+  }
+  double period = (recording.stamps.back() - recording.stamps.front()) / (n - 1);
+
+  std::printf("%-24s rms error %9.5f rad/s   lag %6.1f ms   noise at lag %9.5f rad/s   update %7.1f ns (max %8.1f)\n",
+              name, rms(0), lag * period * 1e3, best, total_ns / (n - 1), max_ns);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Recording recording;
+  if (argc > 1 && std::strcmp(argv[1], "--synthetic") == 0) {
+    double noise = argc > 2 ? std::atof(argv[2]) : 1e-5;
+    double jitter = argc > 3 ? std::atof(argv[3]) : 1e-4;
+    synthesize(noise, jitter, recording);
+    std::printf("Synthetic trajectory, position noise %g rad, stamp jitter %g s\n", noise, jitter);
+  } else if (argc > 1) {
+    std::string topic = argc > 2 ? argv[2] : "/iiwa/state/JointPosition";
+    if (!loadBag(argv[1], topic, recording)) { return 1; }
+    std::printf("%s: %zu samples on %s\n", argv[1], recording.stamps.size(), topic.c_str());
+  } else {
+    std::fprintf(stderr, "Usage: %s <bag> [topic] | --synthetic [noise] [jitter]\n", argv[0]);
+    return 1;
+  }
+
+  std::vector<std::pair<std::string, std::unique_ptr<iiwa_hw::VelocityEstimator>>> estimators;
+  estimators.emplace_back("finite_difference 0.2", std::unique_ptr<iiwa_hw::VelocityEstimator>(
+                                                       new iiwa_hw::FiniteDifferenceEstimator(JOINTS, 0.2)));
+  for (double jerk : {1e3, 1e4, 1e5}) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "kalman %g", jerk);
+    estimators.emplace_back(name, std::unique_ptr<iiwa_hw::VelocityEstimator>(
+                                      new iiwa_hw::KalmanEstimator(JOINTS, jerk, 1e-4)));
+  }
+  for (size_t window : {5, 9, 17}) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "savitzky_golay %zu", window);
+    estimators.emplace_back(name, std::unique_ptr<iiwa_hw::VelocityEstimator>(
+                                      new iiwa_hw::SavitzkyGolayEstimator(JOINTS, window)));
+  }
+
+  for (auto& estimator : estimators) { evaluate(estimator.first.c_str(), *estimator.second, recording); }
+  return 0;
+}
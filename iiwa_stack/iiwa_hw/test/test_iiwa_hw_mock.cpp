@@ -0,0 +1,137 @@
+/**
+ * Copyright (C) 2016 Salvatore Virga - salvo.virga@tum.de, Marco Esposito - marco.esposito@tum.de
+ * Technische Universität München
+ * Chair for Computer Aided Medical Procedures and Augmented Reality
+ * Fakultät für Informatik / I16, Boltzmannstraße 3, 85748 Garching bei München, Germany
+ * http://campar.in.tum.de
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+
+#include <stdexcept>
+#include <string>
+
+#include "iiwa_hw/iiwa_hw.hpp"
+
+namespace {
+
+const char* const JOINT = "iiwa_joint_1";
+
+/** Runs the read/write cycle of the hardware interface at 1 kHz for the given time, applying the command each cycle. */
+template <typename Command>
+void run(iiwa_hw::HardwareInterface& robot, double duration, Command command) {
+  ros::Rate rate(1000.0);
+  ros::Time start = ros::Time::now(), last = start;
+  while ((ros::Time::now() - start).toSec() < duration) {
+    ros::Time now = ros::Time::now();
+    robot.read(now, now - last);
+    command();
+    robot.write(now, now - last);
+    last = now;
+    rate.sleep();
+  }
+  ros::Time now = ros::Time::now();
+  robot.read(now, now - last);
+}
+
+/** Parameters of one hardware interface, in a namespace of its own. */
+ros::NodeHandle configure(const std::string& ns, const std::string& interface, const std::string& backend) {
+  ros::NodeHandle nh(ns);
+  nh.setParam("hardware_interface", interface);
+  nh.setParam("backend", backend);
+  return nh;
+}
+
+}  // namespace
+
+TEST(IiwaHwMock, PositionCommandIsTracked) {
+  ros::NodeHandle nh = configure("position", "PositionJointInterface", "mock");
+  iiwa_hw::HardwareInterface robot;
+  ASSERT_TRUE(robot.init(nh, nh));
+
+  auto* state = robot.get<hardware_interface::JointStateInterface>();
+  auto* position = robot.get<hardware_interface::PositionJointInterface>();
+  ASSERT_NE(state, nullptr);
+  ASSERT_NE(position, nullptr);
+  hardware_interface::JointHandle joint = position->getHandle(JOINT);
+
+  run(robot, 0.3, [&] { joint.setCommand(0.5); });
+
+  EXPECT_NEAR(state->getHandle(JOINT).getPosition(), 0.5, 1e-3);
+  EXPECT_NEAR(state->getHandle(JOINT).getVelocity(), 0.0, 1e-2);
+}
+
+TEST(IiwaHwMock, VelocityCommandIsIntegrated) {
+  ros::NodeHandle nh = configure("velocity", "VelocityJointInterface", "mock");
+  iiwa_hw::HardwareInterface robot;
+  ASSERT_TRUE(robot.init(nh, nh));
+
+  auto* state = robot.get<hardware_interface::JointStateInterface>();
+  hardware_interface::JointHandle joint = robot.get<hardware_interface::VelocityJointInterface>()->getHandle(JOINT);
+
+  run(robot, 0.5, [&] { joint.setCommand(0.2); });
+
+  // the estimator sees the integrated position, the loop jitter only moves where it stops
+  EXPECT_NEAR(state->getHandle(JOINT).getVelocity(), 0.2, 2e-2);
+  EXPECT_GT(state->getHandle(JOINT).getPosition(), 0.05);
+  EXPECT_LT(state->getHandle(JOINT).getPosition(), 0.2);
+}
+
+TEST(IiwaHwMock, EffortCommandDrivesTheJoint) {
+  ros::NodeHandle nh = configure("effort", "EffortJointInterface", "mock");
+  iiwa_hw::HardwareInterface robot;
+  ASSERT_TRUE(robot.init(nh, nh));
+
+  auto* state = robot.get<hardware_interface::JointStateInterface>();
+  hardware_interface::JointHandle joint = robot.get<hardware_interface::EffortJointInterface>()->getHandle(JOINT);
+
+  run(robot, 0.5, [&] { joint.setCommand(1.0); });
+
+  // unit inertia and damping: the measured torque is the command, the joint accelerates towards 1 rad/s
+  EXPECT_NEAR(state->getHandle(JOINT).getEffort(), 1.0, 5e-2);
+  EXPECT_GT(state->getHandle(JOINT).getVelocity(), 0.2);
+  EXPECT_LT(state->getHandle(JOINT).getVelocity(), 1.0);
+  EXPECT_GT(state->getHandle(JOINT).getPosition(), 0.0);
+}
+
+TEST(IiwaHwMock, EffortInterfaceNeedsATorqueBridge) {
+  ros::NodeHandle nh = configure("bridge", "EffortJointInterface", "ros");
+  {
+    iiwa_hw::HardwareInterface robot;
+    EXPECT_THROW(robot.init(nh, nh), std::runtime_error);
+  }
+
+  nh.setParam("torque_bridge", true);
+  iiwa_hw::HardwareInterface robot;
+  EXPECT_TRUE(robot.init(nh, nh));
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  ros::init(argc, argv, "test_iiwa_hw_mock");
+  ros::NodeHandle nh;
+  return RUN_ALL_TESTS();
+}
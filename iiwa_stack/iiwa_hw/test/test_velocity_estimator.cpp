@@ -0,0 +1,174 @@
+/**
+ * Copyright (C) 2016 Salvatore Virga - salvo.virga@tum.de, Marco Esposito - marco.esposito@tum.de
+ * Technische Universität München
+ * Chair for Computer Aided Medical Procedures and Augmented Reality
+ * Fakultät für Informatik / I16, Boltzmannstraße 3, 85748 Garching bei München, Germany
+ * http://campar.in.tum.de
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <random>
+#include <vector>
+
+#include "iiwa_hw/velocity_estimator.hpp"
+
+namespace {
+
+const size_t JOINTS = 2;
+const double PERIOD = 1e-3;
+
+/** Cubic p(t) = c0 + c1*t + c2*t^2 + c3*t^3 of each joint, with its derivatives. */
+struct Polynomial {
+  double c[JOINTS][4];
+
+  double position(size_t j, double t) const { return c[j][0] + t * (c[j][1] + t * (c[j][2] + t * c[j][3])); }
+  double velocity(size_t j, double t) const { return c[j][1] + t * (2.0 * c[j][2] + t * 3.0 * c[j][3]); }
+  double acceleration(size_t j, double t) const { return 2.0 * c[j][2] + t * 6.0 * c[j][3]; }
+};
+
+/** Largest velocity and acceleration errors, and mean acceleration error. */
+struct Errors {
+  double velocity{0.0};
+  double acceleration{0.0};
+  double acceleration_bias{0.0};
+};
+
+/**
+ * Feeds the polynomial sampled for the given time at PERIOD with up to 30% jitter on the stamps, and returns the
+ * largest errors after the settling time.
+ */
+Errors track(iiwa_hw::VelocityEstimator& estimator, const Polynomial& poly, double duration, double settling) {
+  std::mt19937 gen(41);
+  std::uniform_real_distribution<double> jitter(-0.3 * PERIOD, 0.3 * PERIOD);
+  double position[JOINTS];
+  for (size_t j = 0; j < JOINTS; j++) { position[j] = poly.position(j, 0.0); }
+  estimator.reset(position, 0.0);
+
+  Errors errors;
+  size_t samples = 0;
+  for (double t_nominal = PERIOD; t_nominal < duration; t_nominal += PERIOD) {
+    double t = t_nominal + jitter(gen);
+    for (size_t j = 0; j < JOINTS; j++) { position[j] = poly.position(j, t); }
+    estimator.update(position, t);
+    if (t < settling) { continue; }
+    for (size_t j = 0; j < JOINTS; j++) {
+      double acceleration_error = estimator.acceleration()[j] - poly.acceleration(j, t);
+      errors.velocity = std::max(errors.velocity, std::fabs(estimator.velocity()[j] - poly.velocity(j, t)));
+      errors.acceleration = std::max(errors.acceleration, std::fabs(acceleration_error));
+      errors.acceleration_bias += acceleration_error;
+      samples++;
+    }
+  }
+  errors.acceleration_bias = std::fabs(errors.acceleration_bias) / samples;
+  return errors;
+}
+
+// Quadratic and cubic motions of two joints, velocities up to about 1 rad/s.
+const Polynomial QUADRATIC = {{{0.1, 0.5, -0.8, 0.0}, {-0.3, -0.2, 0.6, 0.0}}};
+const Polynomial CUBIC = {{{0.1, 0.5, -0.8, 0.4}, {-0.3, -0.2, 0.6, -0.3}}};
+
+// Largest acceleration of both motions over the run.
+const double MAX_ACCELERATION = 1.6;
+
+TEST(VelocityEstimator, FiniteDifferenceLagsBySmoothingSamples) {
+  // (1 - smoothing) / smoothing = 4 samples of lag, plus half a sample of the difference and the jitter; the
+  // acceleration differentiates the velocity over the jittered intervals, so only its mean is accurate.
+  iiwa_hw::FiniteDifferenceEstimator estimator(JOINTS, 0.2);
+  for (const Polynomial& poly : {QUADRATIC, CUBIC}) {
+    Errors errors = track(estimator, poly, 1.0, 0.1);
+    EXPECT_LT(errors.velocity, 6.0 * PERIOD * MAX_ACCELERATION);
+    EXPECT_LT(errors.acceleration, 0.5 * MAX_ACCELERATION);
+    EXPECT_LT(errors.acceleration_bias, 0.05 * MAX_ACCELERATION);
+  }
+}
+
+TEST(VelocityEstimator, KalmanTracksThePolynomial) {
+  // Exact on constant acceleration once settled, lagging behind the jerk of the cubic.
+  iiwa_hw::KalmanEstimator estimator(JOINTS, 1e3, 1e-4);
+  Errors quadratic = track(estimator, QUADRATIC, 1.0, 0.1);
+  EXPECT_LT(quadratic.velocity, 1e-6);
+  EXPECT_LT(quadratic.acceleration, 1e-4);
+  Errors cubic = track(estimator, CUBIC, 1.0, 0.1);
+  EXPECT_LT(cubic.velocity, 1e-3);
+  EXPECT_LT(cubic.acceleration, 0.05);
+}
+
+TEST(VelocityEstimator, SavitzkyGolayIsExactOnQuadratics) {
+  // The fit uses the actual stamps, so jitter does not matter on a quadratic; on the cubic the error is the
+  // curvature of the acceleration over the window.
+  iiwa_hw::SavitzkyGolayEstimator estimator(JOINTS, 9);
+  Errors quadratic = track(estimator, QUADRATIC, 1.0, 0.02);
+  EXPECT_LT(quadratic.velocity, 1e-9);
+  EXPECT_LT(quadratic.acceleration, 1e-6);
+  Errors cubic = track(estimator, CUBIC, 1.0, 0.02);
+  EXPECT_LT(cubic.velocity, 1e-4);
+  EXPECT_LT(cubic.acceleration, 0.02);
+
+  // A shorter window is raised to the 3 samples a quadratic needs.
+  iiwa_hw::SavitzkyGolayEstimator short_window(JOINTS, 1);
+  quadratic = track(short_window, QUADRATIC, 1.0, 0.02);
+  EXPECT_LT(quadratic.velocity, 1e-6);
+  EXPECT_LT(quadratic.acceleration, 1e-3);
+}
+
+TEST(VelocityEstimator, StaleSamplesAreIgnored) {
+  iiwa_hw::FiniteDifferenceEstimator finite_difference(JOINTS);
+  iiwa_hw::KalmanEstimator kalman(JOINTS);
+  iiwa_hw::SavitzkyGolayEstimator savitzky_golay(JOINTS);
+  for (iiwa_hw::VelocityEstimator* estimator :
+       std::initializer_list<iiwa_hw::VelocityEstimator*>{&finite_difference, &kalman, &savitzky_golay}) {
+    track(*estimator, QUADRATIC, 0.1, 0.0);
+    std::vector<double> velocity(estimator->velocity(), estimator->velocity() + JOINTS);
+    std::vector<double> acceleration(estimator->acceleration(), estimator->acceleration() + JOINTS);
+
+    // Older stamps, far from the motion.
+    double position[JOINTS] = {10.0, -10.0};
+    estimator->update(position, 0.05);
+    estimator->update(position, 0.0);
+    for (size_t j = 0; j < JOINTS; j++) {
+      EXPECT_EQ(velocity[j], estimator->velocity()[j]);
+      EXPECT_EQ(acceleration[j], estimator->acceleration()[j]);
+    }
+
+    // At rest after a reset.
+    estimator->reset(position, 1.0);
+    for (size_t j = 0; j < JOINTS; j++) {
+      EXPECT_EQ(position[j], estimator->position()[j]);
+      EXPECT_EQ(0.0, estimator->velocity()[j]);
+      EXPECT_EQ(0.0, estimator->acceleration()[j]);
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -32,10 +32,17 @@
 
 #include <ros/ros.h>
 #include <std_msgs/Time.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 #include <mutex>
 #include <string>
+#include <type_traits>
 
 namespace iiwa_ros {
+/** Receive time of the last message of any state; see StateStatistics for the per-stream one. */
 extern ros::Time last_update_time;
 
 template <typename ROSMSG>
@@ -60,6 +67,198 @@ private:
   std::mutex mutex_;
 };
 
+/**
+ * @brief Wait-free holder for trivially copyable payloads, with one writer and one reader thread (triple buffer).
+ *
+ * The writer fills its own slot and swaps it with the shared middle slot; the reader takes the middle slot only when
+ * a new value was published since its last get(). Neither side ever waits for the other, so a real-time reader is
+ * never blocked by the callback thread. Before the first set() get() returns a zero-initialized value.
+ */
+template <typename T>
+class RealtimeHolder {
+  static_assert(std::is_trivially_copyable<T>::value, "RealtimeHolder needs a trivially copyable payload");
+
+public:
+  RealtimeHolder() = default;
+
+  /**
+   * @brief Publishes a new value. Must always be called from the same thread.
+   */
+  void set(const T& value) {
+    buffer_[back_] = value;
+    back_ = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel) & INDEX;
+  }
+
+  /**
+   * @brief Returns the latest published value. Must always be called from the same thread.
+   */
+  T get() {
+    if (middle_.load(std::memory_order_relaxed) & FRESH) {
+      front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX;
+    }
+    return buffer_[front_];
+  }
+
+private:
+  enum { INDEX = 3, FRESH = 4 };
+
+  T buffer_[3]{};
+  int back_{0};
+  std::atomic<int> middle_{1};
+  int front_{2};
+};
+
+/**
+ * @brief The seven components of a JointQuantity with the time stamp of their message, in seconds.
+ */
+struct JointSample {
+  double value[7];
+  double stamp;
+};
+
+/**
+ * @brief Converts a JointQuantity message and its header time stamp to a JointSample.
+ */
+template <typename JointQuantity>
+JointSample jointSampleFromQuantity(const JointQuantity& quantity, const ros::Time& stamp) {
+  return {{quantity.a1, quantity.a2, quantity.a3, quantity.a4, quantity.a5, quantity.a6, quantity.a7}, stamp.toSec()};
+}
+
+/**
+ * @brief Receive statistics of a state stream: receive time, header sequence number, drops and inter-arrival times.
+ *
+ * Updated by the subscriber callback only. Every field is a separate atomic, so any number of threads can read it
+ * without locking; fields read one after the other may belong to consecutive updates.
+ */
+class StateStatistics {
+public:
+  /** Number of inter-arrival histogram bins; bin i < BINS - 1 counts intervals below binEdge(i). */
+  enum { BINS = 10 };
+
+  struct Snapshot {
+    double receive_time;  /**< ROS time of the last message [s], 0 before the first one. */
+    uint32_t sequence;    /**< Header sequence number of the last message. */
+    uint64_t received;    /**< Messages received. */
+    uint64_t dropped;     /**< Messages missing from the header sequence. */
+    double mean_period;   /**< Mean inter-arrival time [s]. */
+    double jitter;        /**< Standard deviation of the inter-arrival time [s]. */
+    double min_period;    /**< Shortest inter-arrival time [s]. */
+    double max_period;    /**< Longest inter-arrival time [s]. */
+    uint64_t histogram[BINS];
+  };
+
+  StateStatistics() {
+    for (auto& bin : histogram_) { bin.store(0, std::memory_order_relaxed); }
+  }
+
+  /**
+   * @brief Upper edge of the inter-arrival histogram bin i, in seconds: 0.25 ms doubling at every bin.
+   */
+  static double binEdge(int i) { return 0.25e-3 * (1 << i); }
+
+  /**
+   * @brief Records the arrival of a message. has_sequence is false for messages without a header.
+   */
+  void update(bool has_sequence, uint32_t sequence) {
+    auto now = std::chrono::steady_clock::now();
+    receive_time_.store(ros::Time::now().toSec(), std::memory_order_relaxed);
+    uint64_t received = received_.load(std::memory_order_relaxed) + 1;
+    if (!has_sequence) { sequence = static_cast<uint32_t>(received); }
+
+    if (received > 1) {
+      // Gaps in the sequence are drops, going back means the publisher restarted.
+      uint32_t gap = sequence - sequence_.load(std::memory_order_relaxed);
+      if (gap > 1 && gap < 0x80000000u) {
+        dropped_.store(dropped_.load(std::memory_order_relaxed) + gap - 1, std::memory_order_relaxed);
+      }
+
+      double dt = std::chrono::duration<double>(now - last_arrival_).count();
+      intervals_++;
+      double delta = dt - mean_;
+      mean_ += delta / intervals_;
+      m2_ += delta * (dt - mean_);
+      mean_period_.store(mean_, std::memory_order_relaxed);
+      jitter_.store(std::sqrt(m2_ / intervals_), std::memory_order_relaxed);
+      if (intervals_ == 1 || dt < min_period_.load(std::memory_order_relaxed)) {
+        min_period_.store(dt, std::memory_order_relaxed);
+      }
+      if (dt > max_period_.load(std::memory_order_relaxed)) { max_period_.store(dt, std::memory_order_relaxed); }
+
+      int bin = 0;
+      while (bin < BINS - 1 && dt >= binEdge(bin)) { bin++; }
+      histogram_[bin].store(histogram_[bin].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    last_arrival_ = now;
+    sequence_.store(sequence, std::memory_order_relaxed);
+    received_.store(received, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Seconds since the last message was received, infinite if none was.
+   */
+  double age() const {
+    double receive_time = receive_time_.load(std::memory_order_relaxed);
+    if (receive_time == 0.0) { return std::numeric_limits<double>::infinity(); }
+    return ros::Time::now().toSec() - receive_time;
+  }
+
+  /**
+   * @brief Returns true if a message was received within the last timeout seconds.
+   */
+  bool isConnected(const double timeout = 0.25) const { return age() < timeout; }
+
+  uint32_t sequence() const { return sequence_.load(std::memory_order_relaxed); }
+  uint64_t received() const { return received_.load(std::memory_order_relaxed); }
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  Snapshot snapshot() const {
+    Snapshot snapshot;
+    snapshot.receive_time = receive_time_.load(std::memory_order_relaxed);
+    snapshot.sequence = sequence();
+    snapshot.received = received();
+    snapshot.dropped = dropped();
+    snapshot.mean_period = mean_period_.load(std::memory_order_relaxed);
+    snapshot.jitter = jitter_.load(std::memory_order_relaxed);
+    snapshot.min_period = min_period_.load(std::memory_order_relaxed);
+    snapshot.max_period = max_period_.load(std::memory_order_relaxed);
+    for (int i = 0; i < BINS; i++) { snapshot.histogram[i] = histogram_[i].load(std::memory_order_relaxed); }
+    return snapshot;
+  }
+
+private:
+  // Published to the readers.
+  std::atomic<double> receive_time_{0.0};
+  std::atomic<uint32_t> sequence_{0};
+  std::atomic<uint64_t> received_{0};
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<double> mean_period_{0.0};
+  std::atomic<double> jitter_{0.0};
+  std::atomic<double> min_period_{0.0};
+  std::atomic<double> max_period_{0.0};
+  std::atomic<uint64_t> histogram_[BINS];
+
+  // Owned by the callback thread.
+  std::chrono::steady_clock::time_point last_arrival_{};
+  uint64_t intervals_{0};
+  double mean_{0.0};
+  double m2_{0.0};
+};
+
+/**
+ * @brief Header sequence number of a message; returns false for messages without a header.
+ */
+template <typename ROSMSG>
+auto headerSequence(const ROSMSG& message, uint32_t& sequence, int) -> decltype(message.header.seq, bool()) {
+  sequence = message.header.seq;
+  return true;
+}
+
+template <typename ROSMSG>
+bool headerSequence(const ROSMSG& /*message*/, uint32_t& /*sequence*/, long) {
+  return false;
+}
+
 template <typename ROSMSG>
 class State {
 public:
@@ -77,15 +276,24 @@ public:
 
   void set(ROSMSG value) {
     last_update_time = ros::Time::now();
+    uint32_t sequence = 0;
+    bool has_sequence = headerSequence(value, sequence, 0);
+    statistics_.update(has_sequence, sequence);
     holder_.set(value);
     if (callback_ != nullptr) { callback_(value); }
   }
 
   ROSMSG get() { return holder_.get(); }
 
+  /**
+   * @brief Receive statistics of this stream, readable from any thread without locking.
+   */
+  const StateStatistics& getStatistics() const { return statistics_; }
+
 private:
   std::function<void(const ROSMSG&)> callback_{nullptr};
   Holder<ROSMSG> holder_;
+  StateStatistics statistics_;
   ros::Subscriber subscriber_;
 };
 
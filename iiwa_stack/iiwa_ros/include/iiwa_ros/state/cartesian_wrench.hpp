@@ -61,6 +61,11 @@ public:
    */
   iiwa_msgs::CartesianWrench getWrench();
 
+  /**
+   * @brief Returns the receive statistics of this state, readable from any thread without locking.
+   */
+  const StateStatistics& getStatistics() const override { return state_.getStatistics(); }
+
 private:
   State<iiwa_msgs::CartesianWrench> state_{};
 };
@@ -58,6 +58,11 @@ public:
    */
   std_msgs::Time getTime();
 
+  /**
+   * @brief Returns the receive statistics of this state, readable from any thread without locking.
+   */
+  const StateStatistics& getStatistics() const override { return state_.getStatistics(); }
+
 private:
   State<std_msgs::Time> state_{};
 };
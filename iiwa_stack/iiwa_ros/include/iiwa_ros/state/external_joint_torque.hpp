@@ -58,8 +58,21 @@ public:
    */
   iiwa_msgs::JointTorque getTorque();
 
+  /**
+   * @brief Returns the latest joint external torque and its time stamp without ever blocking on the callback thread.
+   *
+   * Wait-free, for a single real-time reader thread.
+   */
+  JointSample getTorqueSample();
+
+  /**
+   * @brief Returns the receive statistics of this state, readable from any thread without locking.
+   */
+  const StateStatistics& getStatistics() const override { return state_.getStatistics(); }
+
 private:
   State<iiwa_msgs::JointTorque> state_{};
+  RealtimeHolder<JointSample> sample_{};
 };
 
 }  // namespace state
@@ -37,10 +37,15 @@ namespace state {
 
 class GenericState : public Robot {
 public:
-  bool isConnected() {
-    ros::Duration diff = (ros::Time::now() - last_update_time);
-    return (diff < ros::Duration(0.25));
-  }
+  /**
+   * @brief Returns true if this state received a message within the last timeout seconds.
+   */
+  bool isConnected(const double timeout = 0.25) const { return getStatistics().isConnected(timeout); }
+
+  /**
+   * @brief Returns the receive statistics of this state, readable from any thread without locking.
+   */
+  virtual const StateStatistics& getStatistics() const = 0;
 
 protected:
   GenericState() = default;
@@ -58,8 +58,21 @@ public:
    */
   iiwa_msgs::JointPosition getPosition();
 
+  /**
+   * @brief Returns the latest joint position and its time stamp without ever blocking on the callback thread.
+   *
+   * Wait-free, for a single real-time reader thread.
+   */
+  JointSample getPositionSample();
+
+  /**
+   * @brief Returns the receive statistics of this state, readable from any thread without locking.
+   */
+  const StateStatistics& getStatistics() const override { return state_.getStatistics(); }
+
 private:
   State<iiwa_msgs::JointPosition> state_{};
+  RealtimeHolder<JointSample> sample_{};
 };
 
 }  // namespace state
@@ -58,8 +58,21 @@ public:
    */
   iiwa_msgs::JointVelocity getVelocity();
 
+  /**
+   * @brief Returns the latest joint velocity and its time stamp without ever blocking on the callback thread.
+   *
+   * Wait-free, for a single real-time reader thread.
+   */
+  JointSample getVelocitySample();
+
+  /**
+   * @brief Returns the receive statistics of this state, readable from any thread without locking.
+   */
+  const StateStatistics& getStatistics() const override { return state_.getStatistics(); }
+
 private:
   State<iiwa_msgs::JointVelocity> state_{};
+  RealtimeHolder<JointSample> sample_{};
 };
 
 }  // namespace state
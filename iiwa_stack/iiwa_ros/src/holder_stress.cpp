@@ -0,0 +1,130 @@
+/**
+ * Copyright (C) 2016-2019 Salvatore Virga - salvo.virga@tum.de, Marco Esposito - marco.esposito@tum.de
+ * Technische Universität München
+ * Chair for Computer Aided Medical Procedures and Augmented Reality
+ * Fakultät für Informatik / I16, Boltzmannstraße 3, 85748 Garching bei München, Germany
+ * http://campar.in.tum.de
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Worst-case read latency of the state holders under contention: a writer thread publishes joint positions as fast
+// as it can while the reader times every get(), as the real-time read() of the hardware interface would.
+//
+// Usage: holder_stress [seconds per holder, default 2]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <iiwa_msgs/JointPosition.h>
+#include <iiwa_ros/iiwa_ros.hpp>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Latency {
+  double mean_ns;
+  double p999_ns;
+  double max_ns;
+  size_t reads;
+  size_t writes;
+};
+
+template <typename HolderT, typename Payload, typename Check>
+Latency stress(HolderT& holder, Payload payload, double seconds, Check check) {
+  std::atomic<bool> stop{false};
+  size_t writes = 0;
+  std::thread writer([&]() {
+    while (!stop.load(std::memory_order_relaxed)) {
+      holder.set(payload);
+      writes++;
+    }
+  });
+
+  std::vector<double> samples;
+  samples.reserve(1 << 24);
+  auto end = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+  bool torn = false;
+  while (samples.size() < samples.capacity()) {
+    auto t0 = Clock::now();
+    auto value = holder.get();
+    auto t1 = Clock::now();
+    samples.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+    torn |= !check(value);
+    if (t1 >= end) { break; }
+  }
+  stop = true;
+  writer.join();
+  if (torn) { std::printf("  torn read detected!\n"); }
+
+  Latency result{0.0, 0.0, 0.0, samples.size(), writes};
+  for (double s : samples) { result.mean_ns += s; }
+  result.mean_ns /= samples.size();
+  std::sort(samples.begin(), samples.end());
+  result.p999_ns = samples[samples.size() * 999 / 1000];
+  result.max_ns = samples.back();
+  return result;
+}
+
+void print(const char* name, const Latency& l) {
+  std::printf("%-22s reads %10zu  writes %10zu  mean %8.1f ns  p99.9 %9.1f ns  max %11.1f ns\n", name, l.reads,
+              l.writes, l.mean_ns, l.p999_ns, l.max_ns);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  double seconds = argc > 1 ? std::atof(argv[1]) : 2.0;
+
+  // The writer always publishes the same values, any mismatch on the reader side is a torn read.
+  iiwa_msgs::JointPosition message;
+  message.position.a1 = 0.1f;
+  message.position.a2 = 0.2f;
+  message.position.a3 = 0.3f;
+  message.position.a4 = 0.4f;
+  message.position.a5 = 0.5f;
+  message.position.a6 = 0.6f;
+  message.position.a7 = 0.7f;
+  message.header.frame_id = "iiwa_link_0";
+
+  iiwa_ros::Holder<iiwa_msgs::JointPosition> mutex_holder;
+  mutex_holder.set(message);
+  print("Holder (mutex)", stress(mutex_holder, message, seconds, [](const iiwa_msgs::JointPosition& m) {
+          return m.position.a1 == 0.1f && m.position.a7 == 0.7f;
+        }));
+
+  iiwa_ros::RealtimeHolder<iiwa_ros::JointSample> realtime_holder;
+  auto sample = iiwa_ros::jointSampleFromQuantity(message.position, ros::Time(1.0));
+  realtime_holder.set(sample);
+  print("RealtimeHolder", stress(realtime_holder, sample, seconds, [&sample](const iiwa_ros::JointSample& s) {
+          return std::equal(s.value, s.value + 7, sample.value) && s.stamp == sample.stamp;
+        }));
+
+  return 0;
+}
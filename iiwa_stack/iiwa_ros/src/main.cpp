@@ -68,6 +68,13 @@ int main() {
             << " " << std::to_string(joint_position_.position.a4) << " " << std::to_string(joint_position_.position.a5)
             << " " << std::to_string(joint_position_.position.a6) << " " << std::to_string(joint_position_.position.a7)
             << std::endl;);
+
+    // Feed quality of the joint position stream.
+    auto stats = jp_state.getStatistics().snapshot();
+    ROS_INFO_STREAM_THROTTLE(5.0, "JointPosition: " << stats.received << " received, " << stats.dropped
+                                                    << " dropped, period " << stats.mean_period * 1e3 << " ms, jitter "
+                                                    << stats.jitter * 1e3 << " ms, max " << stats.max_period * 1e3
+                                                    << " ms");
     ros::Duration(0.1).sleep();
   }
 
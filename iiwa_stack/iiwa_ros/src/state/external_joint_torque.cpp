@@ -36,17 +36,24 @@ namespace state {
 void ExternalJointTorque::init(const std::string& robot_namespace) {
   setup(robot_namespace);
   initROS("ExternalJointTorqueState");
-  state_.init(ros_namespace_ + "state/ExternalJointTorque");
+  state_.init(ros_namespace_ + "state/ExternalJointTorque", [this](const iiwa_msgs::JointTorque& value) {
+    sample_.set(jointSampleFromQuantity(value.torque, value.header.stamp));
+  });
 }
 
 void ExternalJointTorque::init(const std::string& robot_namespace,
                        const std::function<void(const iiwa_msgs::JointTorque&)> callback) {
   setup(robot_namespace);
   initROS("ExternalJointTorqueState");
-  state_.init(ros_namespace_ + "state/ExternalJointTorque", callback);
+  state_.init(ros_namespace_ + "state/ExternalJointTorque", [this, callback](const iiwa_msgs::JointTorque& value) {
+    sample_.set(jointSampleFromQuantity(value.torque, value.header.stamp));
+    if (callback != nullptr) { callback(value); }
+  });
 }
 
 iiwa_msgs::JointTorque ExternalJointTorque::getTorque() { return state_.get(); }
 
+JointSample ExternalJointTorque::getTorqueSample() { return sample_.get(); }
+
 }  // namespace state
 }  // namespace iiwa_ros
@@ -36,17 +36,24 @@ namespace state {
 void JointPosition::init(const std::string& robot_namespace) {
   setup(robot_namespace);
   initROS("JointPositionState");
-  state_.init(ros_namespace_ + "state/JointPosition");
+  state_.init(ros_namespace_ + "state/JointPosition", [this](const iiwa_msgs::JointPosition& value) {
+    sample_.set(jointSampleFromQuantity(value.position, value.header.stamp));
+  });
 }
 
 void JointPosition::init(const std::string& robot_namespace,
                          const std::function<void(const iiwa_msgs::JointPosition&)> callback) {
   setup(robot_namespace);
   initROS("JointPositionState");
-  state_.init(ros_namespace_ + "state/JointPosition", callback);
+  state_.init(ros_namespace_ + "state/JointPosition", [this, callback](const iiwa_msgs::JointPosition& value) {
+    sample_.set(jointSampleFromQuantity(value.position, value.header.stamp));
+    if (callback != nullptr) { callback(value); }
+  });
 }
 
 iiwa_msgs::JointPosition JointPosition::getPosition() { return state_.get(); }
 
+JointSample JointPosition::getPositionSample() { return sample_.get(); }
+
 }  // namespace state
 }  // namespace iiwa_ros
@@ -36,17 +36,24 @@ namespace state {
 void JointTorque::init(const std::string& robot_namespace) {
   setup(robot_namespace);
   initROS("JointTorqueState");
-  state_.init(ros_namespace_ + "state/JointTorque");
+  state_.init(ros_namespace_ + "state/JointTorque", [this](const iiwa_msgs::JointTorque& value) {
+    sample_.set(jointSampleFromQuantity(value.torque, value.header.stamp));
+  });
 }
 
 void JointTorque::init(const std::string& robot_namespace,
                        const std::function<void(const iiwa_msgs::JointTorque&)> callback) {
   setup(robot_namespace);
   initROS("JointTorqueState");
-  state_.init(ros_namespace_ + "state/JointTorque", callback);
+  state_.init(ros_namespace_ + "state/JointTorque", [this, callback](const iiwa_msgs::JointTorque& value) {
+    sample_.set(jointSampleFromQuantity(value.torque, value.header.stamp));
+    if (callback != nullptr) { callback(value); }
+  });
 }
 
 iiwa_msgs::JointTorque JointTorque::getTorque() { return state_.get(); }
 
+JointSample JointTorque::getTorqueSample() { return sample_.get(); }
+
 }  // namespace state
 }  // namespace iiwa_ros
@@ -36,17 +36,24 @@ namespace state {
 void JointVelocity::init(const std::string& robot_namespace) {
   setup(robot_namespace);
   initROS("JointTorqueState");
-  state_.init(ros_namespace_ + "state/JointVelocity");
+  state_.init(ros_namespace_ + "state/JointVelocity", [this](const iiwa_msgs::JointVelocity& value) {
+    sample_.set(jointSampleFromQuantity(value.velocity, value.header.stamp));
+  });
 }
 
 void JointVelocity::init(const std::string& robot_namespace,
                          const std::function<void(const iiwa_msgs::JointVelocity&)> callback) {
   setup(robot_namespace);
   initROS("JointTorqueState");
-  state_.init(ros_namespace_ + "state/JointVelocity", callback);
+  state_.init(ros_namespace_ + "state/JointVelocity", [this, callback](const iiwa_msgs::JointVelocity& value) {
+    sample_.set(jointSampleFromQuantity(value.velocity, value.header.stamp));
+    if (callback != nullptr) { callback(value); }
+  });
 }
 
 iiwa_msgs::JointVelocity JointVelocity::getVelocity() { return state_.get(); }
 
+JointSample JointVelocity::getVelocitySample() { return sample_.get(); }
+
 }  // namespace state
 }  // namespace iiwa_ros
@@ -0,0 +1,103 @@
+/**
+ * Copyright (C) 2016-2019 Salvatore Virga - salvo.virga@tum.de, Marco Esposito - marco.esposito@tum.de
+ * Technische Universität München
+ * Chair for Computer Aided Medical Procedures and Augmented Reality
+ * Fakultät für Informatik / I16, Boltzmannstraße 3, 85748 Garching bei München, Germany
+ * http://campar.in.tum.de
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ * following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+ * disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ * following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include <iiwa_ros/iiwa_ros.hpp>
+
+namespace {
+
+/** Every component and the stamp hold the same counter, a reader seeing two different values got a torn sample. */
+iiwa_ros::JointSample sampleOf(double k) {
+  iiwa_ros::JointSample sample;
+  std::fill(sample.value, sample.value + 7, k);
+  sample.stamp = k;
+  return sample;
+}
+
+bool isConsistent(const iiwa_ros::JointSample& sample) {
+  return std::all_of(sample.value, sample.value + 7, [&sample](double v) { return v == sample.stamp; });
+}
+
+}  // namespace
+
+TEST(RealtimeHolder, ZeroBeforeTheFirstSet) {
+  iiwa_ros::RealtimeHolder<iiwa_ros::JointSample> holder;
+  EXPECT_TRUE(isConsistent(holder.get()));
+  EXPECT_EQ(holder.get().stamp, 0.0);
+}
+
+TEST(RealtimeHolder, ReturnsTheLatestValue) {
+  iiwa_ros::RealtimeHolder<iiwa_ros::JointSample> holder;
+  for (int k = 1; k <= 10; k++) {
+    holder.set(sampleOf(k));
+    EXPECT_EQ(holder.get().stamp, k);
+    // without a new set() the reader keeps its value
+    EXPECT_EQ(holder.get().stamp, k);
+  }
+
+  holder.set(sampleOf(11));
+  holder.set(sampleOf(12));
+  EXPECT_EQ(holder.get().stamp, 12);
+}
+
+TEST(RealtimeHolder, ConcurrentWriterNeverTearsOrReorders) {
+  iiwa_ros::RealtimeHolder<iiwa_ros::JointSample> holder;
+  const int writes = 2000000;
+
+  std::atomic<bool> done{false};
+  std::thread writer([&]() {
+    for (int k = 1; k <= writes; k++) { holder.set(sampleOf(k)); }
+    done = true;
+  });
+
+  size_t torn = 0, reordered = 0;
+  double last = 0.0;
+  while (!done.load()) {
+    iiwa_ros::JointSample sample = holder.get();
+    torn += !isConsistent(sample);
+    reordered += sample.stamp < last;
+    last = sample.stamp;
+  }
+  writer.join();
+
+  EXPECT_EQ(torn, 0u);
+  EXPECT_EQ(reordered, 0u);
+  EXPECT_EQ(holder.get().stamp, writes);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,82 @@
+#ifndef KDLBATCH
+#define KDLBATCH
+
+#include <kdl/chain.hpp>
+#include <kdl/frames.hpp>
+#include "Eigen/Dense"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// Forward kinematics and Jacobians of many joint configurations at once.
+// Samples are stored structure-of-arrays: row k of every matrix belongs to sample k
+// and each column holds one scalar of all samples, so the recursion runs on blocks of
+// BLOCK samples with Eigen array expressions that vectorize across samples.
+// Frames are stored as 12 columns (position, then rotation column-major), Jacobians
+// as 6*joints columns (column 6*i+r holds J(r,i)), in the base frame with the chain
+// tip as reference point.
+class KDLBatchKinematics
+{
+
+public:
+
+    static const int BLOCK = 64;
+    typedef Eigen::Array<double,BLOCK,1> Lane;
+
+    KDLBatchKinematics(const KDL::Chain &_chain);
+
+    // _q is samples x joints; _jac may be NULL; _threads = 0 uses all cores
+    void fk(const Eigen::MatrixXd &_q, Eigen::MatrixXd &_frames, Eigen::MatrixXd *_jac, unsigned int _threads);
+
+    static KDL::Frame getFrame(const Eigen::MatrixXd &_frames, unsigned int _k);
+    static void setFrame(const KDL::Frame &_F, Eigen::MatrixXd &_frames, unsigned int _k);
+
+    // runs _f(k0, len) over consecutive blocks of _n samples on _threads threads
+    template <typename F>
+    static void parallelBlocks(unsigned int _n, unsigned int _threads, F _f)
+    {
+        unsigned int n_blocks = (_n + BLOCK - 1)/BLOCK;
+        if (_threads == 0) _threads = std::max(1u, std::thread::hardware_concurrency());
+        _threads = std::max(1u, std::min(_threads, n_blocks));
+        auto worker = [&](unsigned int t) {
+            for (unsigned int b = t; b < n_blocks; b += _threads)
+            {
+                _f(b*BLOCK, std::min<unsigned int>(BLOCK, _n - b*BLOCK));
+            }
+        };
+        if (_threads == 1)
+        {
+            worker(0);
+            return;
+        }
+        std::vector<std::thread> pool;
+        for (unsigned int t = 0; t < _threads; t++)
+        {
+            pool.push_back(std::thread(worker, t));
+        }
+        for (unsigned int t = 0; t < _threads; t++)
+        {
+            pool[t].join();
+        }
+    }
+
+private:
+
+    struct SegmentTerms
+    {
+        int jnt;                        // joint index, -1 for fixed joints
+        bool prismatic;
+        Eigen::Matrix3d M0, M1, M2;     // rotation M0 + sin(q)*M1 + cos(q)*M2, M0 if prismatic
+        Eigen::Vector3d p0, p1, p2;     // translation p0 + sin(q)*p1 + cos(q)*p2, p0 + q*p1 if prismatic
+        Eigen::Vector3d axis, origin;   // joint axis and origin in the segment root frame
+    };
+
+    void fkBlock(const Eigen::MatrixXd &_q, Eigen::MatrixXd &_frames, Eigen::MatrixXd *_jac,
+                 unsigned int _k0, unsigned int _len);
+
+    unsigned int n_;
+    std::vector<SegmentTerms> segs_;
+
+};
+
+#endif
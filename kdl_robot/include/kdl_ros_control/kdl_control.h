@@ -3,6 +3,7 @@
 
 #include "Eigen/Dense"
 #include "kdl_robot.h"
+#include "kdl_qp.h"
 #include "utils.h"
 
 class KDLController
@@ -10,6 +11,9 @@ class KDLController
 
 public:
 
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    // throws std::invalid_argument if _robot does not have 7 joints
     KDLController(KDLRobot &_robot);
 
     Eigen::VectorXd idCntr(KDL::JntArray &_qd,
@@ -31,9 +35,105 @@ public:
                            double _Kpp,
                            double _Kdp);                       
 
+    // Operational-space control: tau = J^T*Lambda*(ddx_d + Kd*de + Kp*e - Jdot*dq) + c + g
+    // + N^T*_tau0, with the task-space inertia Lambda = (J*M^-1*J^T)^-1 and the dynamically
+    // consistent null-space projector N^T = I - J^T*Lambda*J*M^-1 applied to the secondary
+    // joint torque _tau0 (none if empty). One Cholesky factorization of M per call.
+    Eigen::VectorXd osCntr(KDL::Frame &_desPos,
+                           KDL::Twist &_desVel,
+                           KDL::Twist &_desAcc,
+                           double _Kpp,
+                           double _Kpo,
+                           double _Kdp,
+                           double _Kdo,
+                           const Eigen::VectorXd &_tau0 = Eigen::VectorXd());
+
+    // Prioritized task stack, by recursive null-space projection at acceleration level:
+    //     ddq_i = ddq_{i-1} + (J_i*P_{i-1})^#M * (ddx_i - Jdot_i*dq - J_i*ddq_{i-1})
+    // with ^#M the dynamically consistent inverse and P_i the projector onto the null space
+    // of tasks 1..i, then tau = M*ddq + c + g. The tasks are
+    //   1) end-effector pose, as in osCntr
+    //   2) joint-limit avoidance: the cost of gradientJointLimits, as a scalar task driven
+    //      back to _jlActivation with stiffness _Kjl once it exceeds it; always active with
+    //      a joint beyond its limits
+    //   3) joint posture _q_posture, with stiffness _Kpq and damping _Kdq
+    // A lower task only acts in the directions left free by the higher ones. All levels
+    // reuse one Cholesky factor of M and work on fixed-size storage, the pose error of
+    // cartesianAcc included; the call only allocates the returned vector, see allocs/op
+    // of BM_StackCntr.
+    Eigen::VectorXd stackCntr(KDL::Frame &_desPos,
+                              KDL::Twist &_desVel,
+                              KDL::Twist &_desAcc,
+                              double _Kpp,
+                              double _Kpo,
+                              double _Kdp,
+                              double _Kdo,
+                              double _Kjl,
+                              double _jlActivation,
+                              const Eigen::VectorXd &_q_posture,
+                              double _Kpq,
+                              double _Kdq);
+
+    // QP control: the joint accelerations that best track the pose reference of osCntr,
+    // plus a small pull towards _ddq_ref (zero if empty), subject to
+    //   - |tau| <= tau_max, with tau = M*ddq + c + g
+    //   - joint position and velocity limits, not to be crossed within the horizon
+    //   - workspace half-spaces n^T*p <= d on the end-effector position, same horizon
+    // solved by KDLQp warm-started from the previous tick. Empty limits are not enforced;
+    // the joint position limits are those of the robot. If the solver stops at its iteration
+    // limit (e.g. braking needs more torque than allowed) the last iterate is clamped to the
+    // joint bounds and the torque to +-tau_max; getQpStats() reports the status and counts
+    // these ticks.
+    Eigen::VectorXd qpCntr(KDL::Frame &_desPos,
+                           KDL::Twist &_desVel,
+                           KDL::Twist &_desAcc,
+                           double _Kpp,
+                           double _Kpo,
+                           double _Kdp,
+                           double _Kdo,
+                           const Eigen::VectorXd &_ddq_ref = Eigen::VectorXd());
+
+    void setQpLimits(const Eigen::VectorXd &_tau_max, const Eigen::VectorXd &_dq_max, double _horizon);
+    // false, and the plane ignored, once the QP would exceed KDLQp::MAX_ROWS rows
+    bool addWorkspacePlane(const Eigen::Vector3d &_n, double _d);
+    void clearWorkspacePlanes();
+
+    // iterations, residuals and solve time of the last qpCntr call
+    const KDLQp::Stats &getQpStats();
+
+    // Impedance control, with the parameters of iiwa_msgs/CartesianImpedanceControlMode and
+    // JointImpedanceControlMode: stiffness, and dimensionless damping ratios turned into
+    // damping with the current inertia. No inertia shaping, c and g compensated.
+    // Cartesian: stiffness [x y z a b c] along the end-effector axes, the null space pulled
+    // towards _q_null (only damped if empty) through the dynamically consistent projector.
+    Eigen::VectorXd cartImpCntr(KDL::Frame &_desPos,
+                                KDL::Twist &_desVel,
+                                const Eigen::Matrix<double,6,1> &_stiffness,
+                                const Eigen::Matrix<double,6,1> &_damping,
+                                double _nullStiffness,
+                                double _nullDamping,
+                                const Eigen::VectorXd &_q_null = Eigen::VectorXd());
+    Eigen::VectorXd jntImpCntr(KDL::JntArray &_qd,
+                               KDL::JntArray &_dqd,
+                               const Eigen::VectorXd &_stiffness,
+                               const Eigen::VectorXd &_damping);
+
 private:
 
+    // desired end-effector acceleration minus Jdot*dq for a PD on the pose error
+    Eigen::Matrix<double,6,1> cartesianAcc(KDL::Frame &_desPos,
+                                           KDL::Twist &_desVel,
+                                           KDL::Twist &_desAcc,
+                                           double _Kpp, double _Kpo,
+                                           double _Kdp, double _Kdo);
+
     KDLRobot* robot_;
+    KDLRobot7 robot7_;      // fixed-size view of robot_ for the 7-joint controllers
+
+    KDLQp qp_;
+    Eigen::VectorXd qpTauMax_, qpDqMax_;
+    double qpHorizon_;
+    Eigen::Matrix<double,Eigen::Dynamic,4> planes_;     // rows n^T, d
 
 };
 
@@ -0,0 +1,79 @@
+#ifndef KDLDYNAMICS
+#define KDLDYNAMICS
+
+#include <kdl/chain.hpp>
+#include <kdl/frames.hpp>
+#include <kdl/jntarray.hpp>
+#include "Eigen/Dense"
+#include <vector>
+
+// Fused recursive kinematics/dynamics kernel for a serial chain.
+// forward() walks the chain once from base to tip and produces the segment poses,
+// the flange twist, Jacobian and Jacobian dot. backward() walks it once from tip to
+// base and produces the mass matrix (CRBA), the Coriolis torques C*qdot (RNEA with
+// zero joint accelerations) and the gravity torques.
+// All quantities are expressed in the base frame; Jacobian and twist use the flange
+// origin as reference point, as the KDL solvers do.
+class KDLDynamics
+{
+
+public:
+
+    KDLDynamics(const KDL::Chain &_chain, const KDL::Vector &_grav);
+
+    void forward(const KDL::JntArray &_q, const KDL::JntArray &_dq);
+    void backward();
+
+    // forward recursion
+    const KDL::Frame &getFrame();
+    const KDL::Twist &getTwist();
+    const Eigen::Matrix<double,6,Eigen::Dynamic> &getJacobian();
+    const Eigen::Matrix<double,6,Eigen::Dynamic> &getJacobianDot();
+    const Eigen::Matrix<double,6,1> &getJacDotqDot();
+
+    // backward recursion
+    const Eigen::MatrixXd &getJsim();
+    const Eigen::VectorXd &getCoriolis();
+    const Eigen::VectorXd &getGravity();
+
+private:
+
+    struct Body
+    {
+        int jnt;                        // joint index, -1 for fixed joints
+        bool prismatic;
+        double m;                       // mass
+        Eigen::Vector3d cog;            // centre of mass in segment tip frame
+        Eigen::Matrix3d I_c;            // rotational inertia about cog in tip frame
+
+        // filled by forward()
+        Eigen::Vector3d s_w, s_v;       // joint motion subspace (angular, linear at base origin)
+        Eigen::Vector3d V_w, V_v;       // body spatial velocity
+        Eigen::Vector3d A_w, A_v;       // body spatial bias acceleration
+        Eigen::Vector3d h;              // first moment of mass m*c
+        Eigen::Matrix3d I_o;            // rotational inertia about base origin
+
+        // filled by backward()
+        double m_sub;                   // composite inertia of this body and its successors
+        Eigen::Vector3d h_sub;
+        Eigen::Matrix3d I_sub;
+        Eigen::Vector3d f_w, f_v;       // composite bias force (moment, force)
+    };
+
+    KDL::Chain chain_;
+    unsigned int n_;
+    Eigen::Vector3d a_grav_;            // base acceleration that emulates gravity
+    std::vector<Body> bodies_;
+
+    KDL::Frame F_tip_;
+    KDL::Twist V_tip_;
+    Eigen::Matrix<double,6,Eigen::Dynamic> J_;
+    Eigen::Matrix<double,6,Eigen::Dynamic> J_dot_;
+    Eigen::Matrix<double,6,1> J_dot_q_dot_;
+    Eigen::MatrixXd M_;
+    Eigen::VectorXd c_;
+    Eigen::VectorXd g_;
+
+};
+
+#endif
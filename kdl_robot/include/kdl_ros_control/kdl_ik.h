@@ -0,0 +1,121 @@
+#ifndef KDLIK
+#define KDLIK
+
+#include <kdl/chain.hpp>
+#include <kdl/frames.hpp>
+#include <kdl/jntarray.hpp>
+#include <kdl/jacobian.hpp>
+#include <kdl/chainfksolverpos_recursive.hpp>
+#include <kdl/chainjnttojacsolver.hpp>
+#include "Eigen/Dense"
+#include <memory>
+
+// Closed-form inverse kinematics for 7-DOF spherical-rotational-spherical arms
+// (KUKA LBR iiwa7/iiwa14). The redundancy is resolved by the arm angle psi, the
+// rotation of the shoulder-elbow-wrist plane about the shoulder-wrist axis, measured
+// from the reference plane in which joint 3 is zero.
+// The solver works on the textbook DH model of the arm; the link lengths, the joint
+// directions and the flange offset are identified from the KDL chain and checked
+// against its forward kinematics at construction.
+class KDLAnalyticIK
+{
+
+public:
+
+    typedef Eigen::Matrix<double,7,1> Vector7;
+    typedef Eigen::Matrix<double,7,8> Solutions;
+
+    KDLAnalyticIK(const KDL::Chain &_chain, const KDL::JntArray &_q_min, const KDL::JntArray &_q_max);
+
+    // false if the chain is not an SRS arm
+    bool isValid();
+
+    // all shoulder/elbow/wrist branches for the given arm angle that are within the
+    // joint limits, stored column-wise; returns their number (0 if unreachable)
+    int solve(const KDL::Frame &_F, double _psi, Solutions &_sols);
+
+    // branch closest to _q_near, at the arm angle of _q_near
+    bool solveNearest(const KDL::Frame &_F, const Vector7 &_q_near, Vector7 &_q_out);
+
+    // arm angle of a joint configuration
+    double getArmAngle(const Vector7 &_q);
+
+private:
+
+    KDL::Frame dhFk(const Vector7 &_q_dh);
+    KDL::Frame chainFk(const Vector7 &_q);
+    Eigen::Matrix3d shoulderRotation(double _q1, double _q2, double _q3);
+    void referencePlane(const Eigen::Vector3d &_x_sw, double _q4, double &_q1, double &_q2);
+
+    KDL::Chain chain_;
+    bool valid_;
+    double d_bs_, d_se_, d_ew_, d_wf_;  // base-shoulder, shoulder-elbow, elbow-wrist, wrist-flange
+    Vector7 sign_;                      // chain joint = sign*DH joint
+    KDL::Frame F_tool_inv_;             // inverse of the flange offset w.r.t. the DH flange
+    Vector7 q_min_, q_max_;
+
+};
+
+// Bounded-time numeric inverse kinematics for any chain. Damped least-squares steps
+// with a backtracking line search, clamped to the joint limits, warm-started from the
+// previous solution unless that one hit the iteration limit. The iteration stops at
+// convergence, at the iteration limit or when the time budget expires, after at least
+// one step, and always returns the best configuration found.
+class KDLNumericIK
+{
+
+public:
+
+    enum Status
+    {
+        CONVERGED = 0,
+        DEADLINE = 1,
+        MAX_ITER = 2
+    };
+
+    struct Result
+    {
+        Status status;
+        unsigned int iterations;
+        double error;                   // norm of the pose error of the returned solution
+    };
+
+    KDLNumericIK(const KDL::Chain &_chain, const KDL::JntArray &_q_min, const KDL::JntArray &_q_max);
+
+    void setParams(double _eps, unsigned int _max_iter, double _lambda);
+    void getParams(double &_eps, unsigned int &_max_iter, double &_lambda);
+
+    // _budget_us <= 0 means no deadline
+    Result solve(const KDL::JntArray &_q_seed, const KDL::Frame &_F, double _budget_us, KDL::JntArray &_q_out);
+
+    // forget the previous solution, e.g. after a jump of the target
+    void resetWarmStart();
+
+private:
+
+    double poseError(const KDL::JntArray &_q, const KDL::Frame &_F);
+    void clampJnts(KDL::JntArray &_q);
+
+    unsigned int n_;
+    std::unique_ptr<KDL::ChainFkSolverPos_recursive> fkSol_;
+    std::unique_ptr<KDL::ChainJntToJacSolver> jacSol_;
+    KDL::JntArray q_min_, q_max_;
+
+    double eps_;
+    unsigned int max_iter_;
+    double lambda_;
+
+    // iteration state, preallocated
+    bool warm_;
+    KDL::JntArray q_warm_;
+    KDL::JntArray q_;
+    KDL::JntArray q_try_;
+    KDL::Jacobian J_;
+    KDL::Frame F_;
+    Eigen::VectorXd dq_;
+    Eigen::Matrix<double,6,1> e_;
+    Eigen::Matrix<double,6,6> A_;
+
+};
+
+#endif
@@ -14,19 +14,17 @@
 #include <kdl/utilities/error.h>
 #include <kdl/trajectory_composite.hpp>
 #include "Eigen/Dense"
+#include "kdl_trajectory.h"
 #include <cmath>
-
-struct trajectory_point{
-  Eigen::Vector3d pos = Eigen::Vector3d::Zero();
-  Eigen::Vector3d vel = Eigen::Vector3d::Zero();
-  Eigen::Vector3d acc = Eigen::Vector3d::Zero();
-};
+#include <memory>
 
 class KDLPlanner
 {
 
 public:
 
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
     KDLPlanner(double _maxVel, double _maxAcc);
 
     void CreateTrajectoryFromFrames(std::vector<KDL::Frame> &_frames,
@@ -38,6 +36,8 @@ public:
                         double alpha,
                         double eqradius);
 
+    // KDL trajectory of the last call above, owned by the planner and replaced by the
+    // next one, so planning repeatedly keeps a flat memory footprint
     KDL::Trajectory* getTrajectory();
 
     //////////////////////////////////
@@ -65,23 +65,85 @@ public:
     trajectory_point path_primitive_linear( double &s, double &dots,double &ddots); 
     trajectory_point path_primitive_circular( double &s, double &dots,double &ddots);
 
+    // ORIENTATION
+    // initial and final end-effector orientation of the typed trajectories, interpolated
+    // with SLERP along the same time law as the position (identity by default)
+    void setOrientation(const Eigen::Matrix3d &_R_init, const Eigen::Matrix3d &_R_end);
+
+    // TYPED TRAJECTORIES
+    // profile ("trapezoidal", "cubic") and path ("linear", "circular") on this planner's
+    // geometry, resolved once; empty for unknown names
+    std::unique_ptr<KDLTrajectory> createTrajectory(const std::string &profile, const std::string &path);
+
+    // WAYPOINTS
+    // through the poses of _frames: C2 spline timed by chord length at average speed
+    // _avgVel, or S-curve moves with blending (see SCurveTrajectory); empty if fewer than
+    // two frames are given
+    std::unique_ptr<KDLTrajectory> createSplineTrajectory(const std::vector<KDL::Frame> &_frames, double _avgVel);
+    std::unique_ptr<KDLTrajectory> createSCurveTrajectory(const std::vector<KDL::Frame> &_frames, double _maxVel,
+                                                          double _maxAcc, double _maxJerk, double _blend,
+                                                          double _maxAngVel = 1.0, double _maxAngAcc = 2.0,
+                                                          double _maxAngJerk = 10.0);
+
+    // PRECOMPUTED TABLE
+    // compile() samples the planned trajectory every _dt seconds and stores one quintic
+    // Hermite polynomial per interval, matching position, velocity and acceleration at
+    // both ends; sample() then evaluates it in constant time, clamped to [0, duration].
+    // The orientation is stored as the rotation at the interval start and a quintic of
+    // the rotation vector from it, exact for constant-axis rotations. compile() returns
+    // false, and leaves the table untouched, for unknown names or a non-positive _dt;
+    // until a table is compiled sample() returns the rest point at the initial position.
+    bool compile(const std::string &profile, const std::string &path, double _dt);
+    bool compile(const KDLTrajectory &_traj, double _dt);
+    bool isCompiled();
+    void sample(double time, trajectory_point &_p);
+    trajectory_point sample(double time);
+
+    // ONLINE REPLANNING
+    // replan() starts at _time a new trajectory from the reference state _current (pose,
+    // velocity, acceleration) to _goal, reached at rest in the shortest time that keeps
+    // the linear and angular speed and acceleration within the limits (or within the
+    // current ones, if already exceeded). It does not allocate and can be called at any
+    // control tick; sampleOnline() follows the last trajectory, at absolute time.
+    void setReplanLimits(double _maxVel, double _maxAcc, double _maxAngVel, double _maxAngAcc);
+    void replan(double _time, const trajectory_point &_current, const KDL::Frame &_goal);
+    void sampleOnline(double time, trajectory_point &_p);
+    trajectory_point sampleOnline(double time);
+
 
 private:
 
-    KDL::Path_RoundedComposite* path_;
-    KDL::Path_Circle* path_circle_;
-	KDL::VelocityProfile* velpref_;
-	KDL::Trajectory* traject_;
+    // the paths own their rotational interpolation; the segment only refers to the path
+    // and the velocity profile, and is declared last so that it is destroyed first
+    std::unique_ptr<KDL::VelocityProfile> velpref_;
+    std::unique_ptr<KDL::Path_RoundedComposite> path_;
+    std::unique_ptr<KDL::Path_Circle> path_circle_;
+    std::unique_ptr<KDL::Trajectory> traject_;
     
 
     //////////////////////////////////
     double trajDuration_, accDuration_;
-    Eigen::Vector3d trajInit_, trajEnd_;
+    Eigen::Vector3d trajInit_ = Eigen::Vector3d::Zero();
+    Eigen::Vector3d trajEnd_ = Eigen::Vector3d::Zero();
     trajectory_point p;
 
     // NEW VARIABLE
 
     double trajRadius_;
+    bool warnedUnknown_ = false;    // compute_trajectory() already reported unknown names
+
+    Eigen::Matrix3d R_init_ = Eigen::Matrix3d::Identity();
+    Eigen::Matrix3d R_end_ = Eigen::Matrix3d::Identity();
+
+    // compiled table, one column per interval: for each position axis (rows 0-17) and
+    // rotation vector axis (rows 18-35) c0..c5 of c0 + c1*tau + ... + c5*tau^5, tau being
+    // the time since the interval start, then the initial rotation as quaternion w,x,y,z
+    Eigen::Matrix<double,40,Eigen::Dynamic> table_ = Eigen::Matrix<double,40,Eigen::Dynamic>(40,0);
+    double tableDt_ = 0.0, tableInvDt_ = 0.0, tableDuration_ = 0.0;
+
+    QuinticTrajectory online_;
+    double onlineStart_ = 0.0;
+    double replanVel_ = 0.25, replanAcc_ = 0.5, replanAngVel_ = 0.5, replanAngAcc_ = 1.0;
 
 
 };
@@ -0,0 +1,80 @@
+#ifndef KDLQP
+#define KDLQP
+
+#include "Eigen/Dense"
+
+// Dense QP solver for the 7-DOF controllers
+//     minimize 0.5*x^T*P*x + q^T*x   subject to   l <= A*x <= u
+// by the ADMM iteration of OSQP, on fixed-capacity matrices (no heap allocation) with
+// at most MAX_ROWS constraints. P must be positive definite. Rows are normalized, the
+// step size rho adapts to the residual balance, and the iterates are kept between calls
+// to warm-start the next solve when the number of rows does not change. The iteration
+// stops at the tolerance or at the iteration limit, returning the last iterate.
+class KDLQp
+{
+
+public:
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    enum { N = 7, MAX_ROWS = 32 };
+
+    typedef Eigen::Matrix<double,N,1> VectorN;
+    typedef Eigen::Matrix<double,N,N> MatrixN;
+    typedef Eigen::Matrix<double,Eigen::Dynamic,N,0,MAX_ROWS,N> Constraints;
+    typedef Eigen::Matrix<double,Eigen::Dynamic,1,0,MAX_ROWS,1> Bounds;
+
+    enum Status
+    {
+        SOLVED = 0,
+        MAX_ITER = 1
+    };
+
+    struct Stats
+    {
+        Status status;
+        unsigned int iterations;
+        double primal_res;              // max violation of A*x = z
+        double dual_res;                // max of P*x + q + A^T*y
+        double solve_us;                // wall time of the last solve
+        double max_solve_us;            // largest solve time since the last resetStats()
+        unsigned int unsolved;          // solves stopped at the iteration limit since then
+    };
+
+    KDLQp();
+
+    void setParams(double _eps, unsigned int _max_iter);
+
+    Status solve(const MatrixN &_P, const VectorN &_q, const Constraints &_A,
+                 const Bounds &_l, const Bounds &_u, VectorN &_x);
+
+    const Stats &getStats() const { return stats_; }
+    void resetStats();
+
+    // forget the previous solution
+    void resetWarmStart();
+
+private:
+
+    void factorize();
+
+    double eps_;
+    unsigned int max_iter_;
+    Stats stats_;
+
+    // problem with normalized rows
+    MatrixN P_;
+    VectorN q_;
+    Constraints A_;
+    Bounds l_, u_;
+
+    // ADMM state
+    bool warm_;
+    double rho_, sigma_, alpha_;
+    Eigen::LLT<MatrixN> llt_;
+    VectorN x_;
+    Bounds z_, y_;
+
+};
+
+#endif
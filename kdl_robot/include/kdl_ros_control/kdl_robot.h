@@ -16,10 +16,16 @@
 #include <kdl/framevel.hpp>
 #include <kdl/frames_io.hpp>
 
+#include "kdl_dynamics.h"
+#include "kdl_ik.h"
+#include "kdl_batch.h"
 #include "utils.h"
+#include <cassert>
 #include <stdio.h>
 #include <iostream>
+#include <memory>
 #include <sstream>
+#include <stdexcept>
 
 class KDLRobot
 {
@@ -29,11 +35,38 @@ public:
     // robot
     KDLRobot();
     KDLRobot(KDL::Tree &robot_tree);
-    void update(std::vector<double> _jnt_values,std::vector<double> _jnt_vel);
+    // throws std::invalid_argument unless both vectors have getNrJnts() entries
+    void update(const std::vector<double> &_jnt_values, const std::vector<double> &_jnt_vel);
+    // allocation-free update for the control loop, inputs must have getNrJnts() entries
+    void update(const Eigen::Ref<const Eigen::VectorXd> &_jnt_values,
+                const Eigen::Ref<const Eigen::VectorXd> &_jnt_vel);
     unsigned int getNrJnts();
     unsigned int getNrSgmts();
     void addEE(const KDL::Frame &_f_tip);
 
+    // lazy evaluation: when enabled, update() only stores the joint state and each
+    // dynamics/kinematics term is computed on first access and cached until the
+    // next update()
+    struct EvalCounters
+    {
+        unsigned int jsim = 0;
+        unsigned int coriolis = 0;
+        unsigned int gravity = 0;
+        unsigned int fk = 0;
+        unsigned int jac = 0;
+        unsigned int jac_dot = 0;
+    };
+    void setLazyEval(bool _lazy);
+    bool getLazyEval();
+    // terms recomputed since the last update()
+    const EvalCounters &getEvalCounters();
+
+    // fused dynamics: when enabled, the flange kinematics come from a single forward
+    // recursion and M, C*qdot and g from a single backward recursion of KDLDynamics
+    // instead of the separate KDL solvers
+    void setFusedDynamics(bool _fused);
+    bool getFusedDynamics();
+
     // joints
     Eigen::MatrixXd getJntLimits();
     Eigen::MatrixXd getJsim();
@@ -51,10 +84,36 @@ public:
     KDL::ChainIkSolverPos_NR_JL* ikSol_;
     KDL::JntArray getInvKin(const KDL::JntArray &q,
                             const KDL::Frame &eeFrame);
+    // analytic inverse kinematics: when enabled, getInvKin() returns the closed-form
+    // branch closest to the seed at the seed arm angle, and falls back to the numeric
+    // solver if the pose is unreachable there
+    void setAnalyticIk(bool _analytic);
+    bool getAnalyticIk();
+    // all closed-form branches within the joint limits at arm angle _psi, returns their number
+    int getInvKinAnalytic(const KDL::Frame &eeFrame, double _psi, KDLAnalyticIK::Solutions &_sols);
+    double getArmAngle(const KDL::JntArray &q);
+    // bounded-time numeric inverse kinematics for the control loop: returns the best
+    // solution found within _budget_us microseconds, warm-started from the previous
+    // call; the analytic solver is tried first when enabled
+    KDL::JntArray getInvKin(const KDL::JntArray &q,
+                            const KDL::Frame &eeFrame,
+                            double _budget_us,
+                            KDLNumericIK::Result &_result);
+    // tolerance, iteration limit and damping of the numeric solver, also used by getInvKinBatch
+    void setInvKinParams(double _eps, unsigned int _max_iter, double _lambda);
     KDL::JntArray getInvKinVel(const KDL::JntArray &qd,
                         const KDL::Twist &eeFrameVel);
     Eigen::Matrix<double,7,1> getInvKinAcc(const KDL::Twist &eeFrameAcc,const KDL::JntArray &dqd,
                                 Eigen::Matrix<double,6,7> J,Eigen::Matrix<double,6,7> Jdot);
+    // batch kinematics for offline evaluation of many samples, in the structure-of-arrays
+    // layout of KDLBatchKinematics: row k of every matrix is sample k. Frames and
+    // Jacobians are those of the end-effector; IK targets are end-effector frames and
+    // each sample is solved independently of the others. _threads = 0 uses all cores.
+    void getFkBatch(const Eigen::MatrixXd &_q, Eigen::MatrixXd &_frames,
+                    Eigen::MatrixXd *_jac = NULL, unsigned int _threads = 0);
+    void getInvKinBatch(const Eigen::MatrixXd &_q_seed, const Eigen::MatrixXd &_frames, double _budget_us,
+                        Eigen::MatrixXd &_q_out, Eigen::VectorXi &_status, unsigned int _threads = 0);
+
     // end-effector
     KDL::Frame getEEFrame();
     KDL::Frame getFlangeEE();
@@ -73,7 +132,7 @@ public:
                               KDL::JntArray &dq,
                               KDL::JntArray &ddq);
 
-private:
+protected:
 
     // chain
     unsigned int n_;
@@ -84,14 +143,45 @@ private:
     KDL::ChainFkSolverPos_recursive* fkSol_;
     KDL::ChainFkSolverVel_recursive* fkVelSol_;
     KDL::ChainJntToJacDotSolver* jntJacDotSol_;
+    std::unique_ptr<KDLDynamics> fusedDyn_;
+    std::unique_ptr<KDLAnalyticIK> analyticIk_;
+    std::unique_ptr<KDLNumericIK> numericIk_;
+    std::unique_ptr<KDLBatchKinematics> batchKin_;  // chain extended with the end-effector frame
+    bool analyticIkOn_ = false;
     // KDL::ChainIkSolverPos_NR_JL* ikSol_;
     KDL::ChainIkSolverVel_wdls* ikVelSol_;
 
+    // lazy evaluation
+    enum DirtyTerm
+    {
+        DIRTY_JSIM     = 1 << 0,
+        DIRTY_CORIOLIS = 1 << 1,
+        DIRTY_GRAVITY  = 1 << 2,
+        DIRTY_FK       = 1 << 3,
+        DIRTY_JAC      = 1 << 4,
+        DIRTY_JAC_DOT  = 1 << 5,
+        DIRTY_ALL      = (1 << 6) - 1
+    };
+    void evalJsim();
+    void evalCoriolis();
+    void evalGravity();
+    void evalFk();
+    void evalJac();
+    void evalJacDot();
+    void evalFusedBackward();
+    bool lazy_ = false;
+    bool fused_ = false;
+    bool fusedBackwardDone_ = false;
+    unsigned int dirty_ = DIRTY_ALL;
+    EvalCounters evalCounters_;
+
     // joints
-    void updateJnts(std::vector<double> _jnt_values, std::vector<double> _jnt_vel);
+    void updateJnts(const Eigen::Ref<const Eigen::VectorXd> &_jnt_values,
+                    const Eigen::Ref<const Eigen::VectorXd> &_jnt_vel);
     KDL::JntSpaceInertiaMatrix jsim_;
     KDL::JntArray jntArray_;
     KDL::JntArray jntVel_;
+    KDL::JntArrayVel jntArrayVel_;  // (q, qdot) pair fed to the velocity solvers
     KDL::JntArray coriol_;
     KDL::JntArray grav_;
     KDL::JntArray q_min_;
@@ -107,6 +197,80 @@ private:
     KDL::Jacobian b_J_dot_ee_;      // end-effector Jacobian dot in body frame
     KDL::Twist s_J_dot_q_dot_ee_;   // end-effector Jdot*qdot in spatial frame
 
+    // flange scratch state, preallocated so that update() does not allocate
+    KDL::FrameVel s_Fv_f_;          // flange frame and twist in spatial frame
+    KDL::Jacobian s_J_f_;           // flange Jacobian in spatial frame
+    KDL::Jacobian s_J_dot_f_;       // flange Jacobian dot in spatial frame
+    KDL::Vector s_p_f_ee_;          // flange to end-effector vector in spatial frame
+
+    template <int N> friend class KDLRobotN;
+
 };
 
+// Fixed-size view of a KDLRobot with N joints (KDLRobot7 for the iiwa7/iiwa14).
+// It does not derive from KDLRobot: the state stays in the robot it refers to and
+// every getter evaluates the term there, copies it into a fixed-size member and
+// returns it by const reference, so downstream Eigen expressions are sized at
+// compile time and never see a stale state.
+template <int N>
+class KDLRobotN
+{
+
+public:
+    typedef Eigen::Matrix<double,N,1> VectorN;
+    typedef Eigen::Matrix<double,N,N> MatrixN;
+    typedef Eigen::Matrix<double,N,2> LimitsN;
+    typedef Eigen::Matrix<double,6,N> JacobianN;
+    typedef Eigen::Matrix<double,6,1> Vector6;
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    explicit KDLRobotN(KDLRobot &_robot) : robot_(&_robot)
+    {
+        if (_robot.getNrJnts() != N)
+        {
+            std::stringstream ss;
+            ss << "KDL robot has " << _robot.getNrJnts() << " joints, expected " << N;
+            throw std::invalid_argument(ss.str());
+        }
+        limits_.col(0) = _robot.q_min_.data;
+        limits_.col(1) = _robot.q_max_.data;
+    }
+
+    KDLRobot &robot() { return *robot_; }
+
+    // joints
+    const LimitsN &getJntLimits() const { return limits_; }
+    const VectorN &getJntValues() { q_ = robot_->jntArray_.data; return q_; }
+    const VectorN &getJntVelocities() { dq_ = robot_->jntVel_.data; return dq_; }
+    const MatrixN &getJsim() { robot_->evalJsim(); M_ = robot_->jsim_.data; return M_; }
+    const VectorN &getCoriolis() { robot_->evalCoriolis(); c_ = robot_->coriol_.data; return c_; }
+    const VectorN &getGravity() { robot_->evalGravity(); g_ = robot_->grav_.data; return g_; }
+
+    // end-effector
+    const JacobianN &getEEJacobian() { robot_->evalJac(); J_ = robot_->s_J_ee_.data; return J_; }
+    const JacobianN &getEEJacobianDot() { robot_->evalJacDot(); Jdot_ = robot_->s_J_dot_ee_.data; return Jdot_; }
+    const Vector6 &getEEJacDotqDot()
+    {
+        Jdot_qdot_.noalias() = getEEJacobianDot()*getJntVelocities();
+        return Jdot_qdot_;
+    }
+
+private:
+
+    KDLRobot* robot_;
+    LimitsN limits_;
+    VectorN q_;
+    VectorN dq_;
+    MatrixN M_;
+    VectorN c_;
+    VectorN g_;
+    JacobianN J_;
+    JacobianN Jdot_;
+    Vector6 Jdot_qdot_;
+
+};
+
+typedef KDLRobotN<7> KDLRobot7;
+
 #endif
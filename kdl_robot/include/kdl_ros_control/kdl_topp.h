@@ -0,0 +1,88 @@
+#ifndef KDLTOPP
+#define KDLTOPP
+
+#include "kdl_robot.h"
+#include "kdl_trajectory.h"
+#include <string>
+#include <vector>
+
+// Time-optimal profile produced by KDLTopp: piecewise constant path acceleration
+// on the s grid. It is a time law like TrapezoidalProfile and CubicProfile, so it
+// can drive the path primitives through ProfiledPath.
+class TimeOptimalProfile
+{
+public:
+    TimeOptimalProfile() {}
+
+    void eval(double t, double &s, double &ds, double &dds) const;
+    double duration() const { return t_.empty() ? 0.0 : t_.back(); }
+
+    // grid values: abscissa, time, path speed at each point, path acceleration on each interval
+    std::vector<double> s_, t_, ds_, dds_;
+};
+
+// Time-optimal path parametrization (reachability analysis) of a joint path q(s),
+// s in [0,1], under joint velocity, acceleration and torque limits, with the
+// dynamics of KDLRobot. The path is discretized on a uniform s grid; the backward
+// pass computes the largest path speed from which the end can still be reached at
+// rest, the forward pass takes the largest feasible acceleration that stays below
+// it. Starts and ends at rest.
+class KDLTopp
+{
+
+public:
+
+    // per-joint limits, non-positive entries are not enforced
+    struct Limits
+    {
+        Eigen::VectorXd max_vel;
+        Eigen::VectorXd max_acc;
+        Eigen::VectorXd max_effort;
+    };
+
+    // reads max_velocity/max_acceleration of the joints in the MoveIt joint_limits.yaml
+    // format, in file order; efforts are left unlimited
+    static bool loadLimits(const std::string &_file, unsigned int _n, Limits &_lim);
+
+    KDLTopp(KDLRobot &_robot, const Limits &_lim, unsigned int _n_grid = 200);
+
+    // _q_path holds q(s) at the _n_grid + 1 grid points, one row per point
+    bool compute(const Eigen::MatrixXd &_q_path, TimeOptimalProfile &_profile);
+
+    // Cartesian path primitive of the end-effector set with addEE, at fixed orientation
+    // _R; joint path by inverse kinematics of the flange, seeded from _q_seed along the path
+    template <class Path>
+    bool compute(const Path &_path, const KDL::Rotation &_R, const KDL::JntArray &_q_seed,
+                 TimeOptimalProfile &_profile)
+    {
+        Eigen::MatrixXd q_path(n_grid_ + 1, robot_.getNrJnts());
+        KDL::JntArray q = _q_seed;
+        KDL::Frame F_ee_inv = robot_.getFlangeEE().Inverse();
+        trajectory_point p;
+        for (unsigned int i = 0; i <= n_grid_; i++)
+        {
+            _path.eval(double(i)/n_grid_, 0.0, 0.0, p);
+            q = robot_.getInvKin(q, KDL::Frame(_R, toKDL(p.pos))*F_ee_inv);
+            q_path.row(i) = q.data.transpose();
+        }
+        return compute(q_path, _profile);
+    }
+
+private:
+
+    // half-planes alpha*x + beta*u <= gamma in x = ds^2, u = dds
+    struct HalfPlane
+    {
+        double alpha, beta, gamma;
+    };
+
+    void buildConstraints(const Eigen::MatrixXd &_q_path, unsigned int _i, std::vector<HalfPlane> &_c);
+    static bool maxX(const std::vector<HalfPlane> &_c, double &_x);
+
+    KDLRobot &robot_;
+    Limits lim_;
+    unsigned int n_grid_;
+
+};
+
+#endif
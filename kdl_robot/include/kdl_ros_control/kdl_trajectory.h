@@ -0,0 +1,352 @@
+#ifndef KDLTRAJECTORY
+#define KDLTRAJECTORY
+
+#include "Eigen/Dense"
+#include <cmath>
+#include <vector>
+
+struct trajectory_point{
+  Eigen::Vector3d pos = Eigen::Vector3d::Zero();
+  Eigen::Vector3d vel = Eigen::Vector3d::Zero();
+  Eigen::Vector3d acc = Eigen::Vector3d::Zero();
+  // orientation, angular velocity and acceleration in the base frame
+  Eigen::Matrix3d rot = Eigen::Matrix3d::Identity();
+  Eigen::Vector3d omega = Eigen::Vector3d::Zero();
+  Eigen::Vector3d domega = Eigen::Vector3d::Zero();
+};
+
+// rotation vector of R and its inverse
+inline Eigen::Vector3d logRotation(const Eigen::Matrix3d &R)
+{
+    Eigen::AngleAxisd aa(R);
+    return aa.angle()*aa.axis();
+}
+
+inline Eigen::Matrix3d expRotation(const Eigen::Vector3d &phi)
+{
+    double angle = phi.norm();
+    if (angle < 1e-12) return Eigen::Matrix3d::Identity();
+    return Eigen::AngleAxisd(angle, phi/angle).toRotationMatrix();
+}
+
+// coefficients c0..c5 of the quintic over [0,h] with the given values, first and second
+// derivatives at both ends
+inline void quinticCoeffs(double x0, double v0, double a0, double x1, double v1, double a1, double h, double *c)
+{
+    double dx = x1 - x0;
+    c[0] = x0;
+    c[1] = v0;
+    c[2] = 0.5*a0;
+    c[3] = (20*dx - (8*v1 + 12*v0)*h - (3*a0 - a1)*h*h)/(2*h*h*h);
+    c[4] = (-30*dx + (14*v1 + 16*v0)*h + (3*a0 - 2*a1)*h*h)/(2*h*h*h*h);
+    c[5] = (12*dx - 6*(v1 + v0)*h + (a1 - a0)*h*h)/(2*h*h*h*h*h);
+}
+
+// Typed trajectory primitives. A profile maps time to the curvilinear abscissa
+// s in [0,1] and its derivatives, a path maps (s, ds, dds) to a Cartesian point.
+// Any profile type with
+//     void eval(double t, double &s, double &ds, double &dds) const;
+//     double duration() const;
+// can be combined with any path type with
+//     void eval(double s, double ds, double dds, trajectory_point &p) const;
+// and optionally an orientation type with the same eval() signature, filling the
+// rotational part, through ProfiledPath, which fixes the combination at compile time.
+
+// TIME LAWS
+class TrapezoidalProfile
+{
+public:
+    TrapezoidalProfile(double _duration, double _accDuration)
+        : duration_(_duration), accDuration_(_accDuration),
+          ddot_c_(-1.0/(_accDuration*_accDuration - _duration*_accDuration)) {}
+
+    void eval(double t, double &s, double &ds, double &dds) const
+    {
+        if (t <= accDuration_)
+        {
+            s = 0.5*ddot_c_*t*t;
+            ds = ddot_c_*t;
+            dds = ddot_c_;
+        }
+        else if (t <= duration_ - accDuration_)
+        {
+            s = ddot_c_*accDuration_*(t - accDuration_/2);
+            ds = ddot_c_*accDuration_;
+            dds = 0;
+        }
+        else
+        {
+            s = 1 - 0.5*ddot_c_*(duration_ - t)*(duration_ - t);
+            ds = ddot_c_*(duration_ - t);
+            dds = -ddot_c_;
+        }
+    }
+
+    double duration() const { return duration_; }
+
+private:
+    double duration_, accDuration_, ddot_c_;
+};
+
+class CubicProfile
+{
+public:
+    CubicProfile(double _duration)
+        : duration_(_duration), a2_(3/(_duration*_duration)), a3_(-2/(_duration*_duration*_duration)) {}
+
+    void eval(double t, double &s, double &ds, double &dds) const
+    {
+        s = (a3_*t + a2_)*t*t;
+        ds = (3*a3_*t + 2*a2_)*t;
+        dds = 6*a3_*t + 2*a2_;
+    }
+
+    double duration() const { return duration_; }
+
+private:
+    double duration_, a2_, a3_;
+};
+
+// PATHS
+class LinearPath
+{
+public:
+    LinearPath(const Eigen::Vector3d &_init, const Eigen::Vector3d &_end)
+        : init_(_init), dif_(_end - _init) {}
+
+    void eval(double s, double ds, double dds, trajectory_point &p) const
+    {
+        p.pos = init_ + s*dif_;
+        p.vel = ds*dif_;
+        p.acc = dds*dif_;
+    }
+
+private:
+    Eigen::Vector3d init_, dif_;
+};
+
+// full circle in the y-z plane through _init, centred _radius along y
+class CircularPath
+{
+public:
+    CircularPath(const Eigen::Vector3d &_init, double _radius)
+        : centre_(_init + Eigen::Vector3d(0, _radius, 0)), radius_(_radius) {}
+
+    void eval(double s, double ds, double dds, trajectory_point &p) const
+    {
+        double c = std::cos(2*M_PI*s), sn = std::sin(2*M_PI*s);
+        double w = 2*M_PI*radius_;
+        p.pos << centre_[0], centre_[1] - radius_*c, centre_[2] - radius_*sn;
+        p.vel << 0, w*ds*sn, -w*ds*c;
+        p.acc << 0, w*(ds*ds*2*M_PI*c + dds*sn), -w*(-ds*ds*2*M_PI*sn + dds*c);
+    }
+
+private:
+    Eigen::Vector3d centre_;
+    double radius_;
+};
+
+// ORIENTATIONS
+class FixedOrientation
+{
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    FixedOrientation(const Eigen::Matrix3d &_R = Eigen::Matrix3d::Identity()) : R_(_R) {}
+
+    void eval(double, double, double, trajectory_point &p) const
+    {
+        p.rot = R_;
+        p.omega.setZero();
+        p.domega.setZero();
+    }
+
+private:
+    Eigen::Matrix3d R_;
+};
+
+// constant-axis rotation from _R_init to _R_end (SLERP), angle proportional to s
+class SlerpOrientation
+{
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    SlerpOrientation(const Eigen::Matrix3d &_R_init, const Eigen::Matrix3d &_R_end)
+        : R_init_(_R_init), phi_(logRotation(_R_init.transpose()*_R_end)), s_phi_(_R_init*phi_) {}
+
+    void eval(double s, double ds, double dds, trajectory_point &p) const
+    {
+        p.rot = R_init_*expRotation(s*phi_);
+        p.omega = ds*s_phi_;
+        p.domega = dds*s_phi_;
+    }
+
+private:
+    Eigen::Matrix3d R_init_;
+    Eigen::Vector3d phi_;           // rotation vector in the initial frame
+    Eigen::Vector3d s_phi_;         // same in the base frame
+};
+
+// TRAJECTORIES
+// common interface for code that picks the trajectory at run time: one indirect call
+class KDLTrajectory
+{
+public:
+    virtual ~KDLTrajectory() {}
+    virtual void compute(double t, trajectory_point &p) const = 0;
+    virtual double duration() const = 0;
+
+    trajectory_point compute(double t) const
+    {
+        trajectory_point p;
+        compute(t, p);
+        return p;
+    }
+};
+
+template <class Profile, class Path, class Orientation = FixedOrientation>
+class ProfiledPath : public KDLTrajectory
+{
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    ProfiledPath(const Profile &_profile, const Path &_path, const Orientation &_orientation = Orientation())
+        : profile_(_profile), path_(_path), orientation_(_orientation) {}
+
+    using KDLTrajectory::compute;
+    void compute(double t, trajectory_point &p) const override
+    {
+        double s, ds, dds;
+        profile_.eval(t, s, ds, dds);
+        path_.eval(s, ds, dds, p);
+        orientation_.eval(s, ds, dds, p);
+    }
+
+    double duration() const override { return profile_.duration(); }
+
+private:
+    Profile profile_;
+    Path path_;
+    Orientation orientation_;
+};
+
+// C2 cubic spline through waypoints reached at the given times, at rest at both ends.
+// With _rotations, the orientation is R_0*exp(phi(t)), phi being the same C2 spline through
+// the rotation vectors of the waypoints relative to the first one (each taken on the branch
+// closest to the previous one), so the angular velocity and acceleration are continuous
+// and the orientation does not stop at the waypoints either.
+class SplineTrajectory : public KDLTrajectory
+{
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    SplineTrajectory(const std::vector<Eigen::Vector3d> &_points, const std::vector<double> &_times,
+                     const std::vector<Eigen::Matrix3d> &_rotations = std::vector<Eigen::Matrix3d>());
+
+    using KDLTrajectory::compute;
+    void compute(double t, trajectory_point &p) const override;
+    double duration() const override { return times_.back(); }
+
+private:
+    typedef std::vector< Eigen::Matrix<double,3,4>, Eigen::aligned_allocator< Eigen::Matrix<double,3,4> > > Cubics;
+    static void interpolate(const std::vector<Eigen::Vector3d> &_points, const std::vector<double> &_times,
+                            Cubics &_coeffs);
+
+    std::vector<double> times_;
+    Cubics coeffs_;
+    Cubics rotCoeffs_;              // spline of the rotation vector from R_init_, if any
+    Eigen::Matrix3d R_init_;
+};
+
+// Jerk-limited double-S time law from 0 to 1 over a straight segment of length _dist,
+// at rest at both ends, with limits on the Cartesian speed, acceleration and jerk
+class SCurveProfile
+{
+public:
+    SCurveProfile(double _dist, double _maxVel, double _maxAcc, double _maxJerk);
+
+    void eval(double t, double &s, double &ds, double &dds) const;
+    double duration() const { return 2*Ta_ + Tv_; }
+
+private:
+    void accPhase(double t, double &s, double &ds, double &dds) const;
+    double dist_, jerk_, Tj_, Ta_, Tv_, aLim_, vLim_;
+};
+
+// Straight moves between consecutive waypoints, each with an S-curve time law. Each
+// move starts when the previous one has the fraction _blend of its duration left:
+// 0 stops at every waypoint, larger values round the corners and shorten the cycle;
+// while two moves overlap their accelerations add, so the corner may see up to twice
+// the acceleration and jerk limits.
+// With _rotations, each move also turns about a constant axis with the same time law,
+// timed by the slower of the linear and angular limits.
+class SCurveTrajectory : public KDLTrajectory
+{
+public:
+    SCurveTrajectory(const std::vector<Eigen::Vector3d> &_points, double _maxVel, double _maxAcc,
+                     double _maxJerk, double _blend);
+    SCurveTrajectory(const std::vector<Eigen::Vector3d> &_points, const std::vector<Eigen::Matrix3d> &_rotations,
+                     double _maxVel, double _maxAcc, double _maxJerk,
+                     double _maxAngVel, double _maxAngAcc, double _maxAngJerk, double _blend);
+
+    using KDLTrajectory::compute;
+    void compute(double t, trajectory_point &p) const override;
+    double duration() const override { return duration_; }
+
+private:
+    void init(const std::vector<Eigen::Vector3d> &_points, const std::vector<Eigen::Matrix3d> &_rotations,
+              double _maxVel, double _maxAcc, double _maxJerk,
+              double _maxAngVel, double _maxAngAcc, double _maxAngJerk, double _blend);
+
+    Eigen::Vector3d init_;
+    Eigen::Matrix3d R_init_;
+    std::vector< Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > dif_;
+    std::vector< Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > phi_;   // rotation vector of each move, in its initial frame
+    std::vector<SCurveProfile> profiles_;
+    std::vector<double> start_;
+    double duration_;
+};
+
+// Quintic from an arbitrary state (pose, velocity and acceleration) to a goal pose
+// reached at rest, used for online replanning. The orientation follows a quintic of the
+// rotation vector from the initial rotation: continuous in rotation, angular velocity and
+// acceleration at the start, exact for constant-axis rotations.
+class QuinticTrajectory : public KDLTrajectory
+{
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    QuinticTrajectory();
+    QuinticTrajectory(const trajectory_point &_start, const Eigen::Vector3d &_goal_pos,
+                      const Eigen::Matrix3d &_goal_rot, double _duration);
+
+    using KDLTrajectory::compute;
+    void compute(double t, trajectory_point &p) const override;
+    double duration() const override { return duration_; }
+
+    // largest linear and angular speed and acceleration, sampled at _n points
+    void peaks(unsigned int _n, double &_vel, double &_acc, double &_angVel, double &_angAcc) const;
+
+private:
+    void eval(double t, Eigen::Matrix<double,6,1> &x, Eigen::Matrix<double,6,1> &v,
+              Eigen::Matrix<double,6,1> &a) const;
+
+    Eigen::Matrix<double,6,6> c_;   // one row per axis: position, then rotation vector
+    Eigen::Matrix3d R_init_;
+    double duration_;
+};
+
+template <class Profile, class Path>
+ProfiledPath<Profile, Path> makeProfiledPath(const Profile &_profile, const Path &_path)
+{
+    return ProfiledPath<Profile, Path>(_profile, _path);
+}
+
+template <class Profile, class Path, class Orientation>
+ProfiledPath<Profile, Path, Orientation> makeProfiledPath(const Profile &_profile, const Path &_path,
+                                                          const Orientation &_orientation)
+{
+    return ProfiledPath<Profile, Path, Orientation>(_profile, _path, _orientation);
+}
+
+#endif
@@ -12,6 +12,13 @@ inline KDL::Vector toKDL(const Eigen::Vector3d& v)
     return KDL::Vector(v[0],v[1],v[2]);
 }
 
+inline KDL::Rotation toKDL(const Eigen::Matrix3d& R)
+{
+    return KDL::Rotation(R(0,0),R(0,1),R(0,2),
+                         R(1,0),R(1,1),R(1,2),
+                         R(2,0),R(2,1),R(2,2));
+}
+
 inline KDL::Wrench toKDLWrench(const Eigen::Matrix<double,6,1>& w)
 {
     return KDL::Wrench(KDL::Vector(w[0], w[1], w[2]), KDL::Vector(w[3], w[4], w[5]));
@@ -175,6 +182,16 @@ pseudoinverse(const MatT &mat, typename MatT::Scalar tolerance = typename MatT::
     return svd.matrixV() * singularValuesInv * svd.matrixU().adjoint();
 }
 
+// damped least-squares pseudoinverse J^T*(J*J^T + lambda^2*I)^-1 of a fixed-size
+// matrix with no more rows than columns, by LDLT; allocation free
+template <int Rows, int Cols, int Options>
+Eigen::Matrix<double,Cols,Rows> dampedPseudoinverse(const Eigen::Matrix<double,Rows,Cols,Options> &J, double lambda = 1e-3)
+{
+    Eigen::Matrix<double,Rows,Rows> A = J*J.transpose();
+    A.diagonal().array() += lambda*lambda;
+    return J.transpose()*A.ldlt().solve(Eigen::Matrix<double,Rows,Rows>::Identity());
+}
+
 inline Eigen::Matrix<double,3,1> computeOrientationError(const Eigen::Matrix<double,3,3> &_R_d, 
                                                          const Eigen::Matrix<double,3,3> &_R_e)
 {
@@ -194,6 +211,18 @@ inline Eigen::Matrix<double,3,1> computeOrientationError(const Eigen::Matrix<dou
 }
 
 
+// quaternion error 2*eps of q_d*q_e^-1, taken on the hemisphere with eta >= 0: equal to
+// the angle-axis error at first order, and not vanishing for rotations up to pi
+template <int Options>
+Eigen::Matrix<double,3,1> computeOrientationErrorQuat(const Eigen::Matrix<double,3,3,Options> &_R_d,
+                                                      const Eigen::Matrix<double,3,3,Options> &_R_e)
+{
+    Eigen::Quaterniond q_d(_R_d), q_e(_R_e);
+    Eigen::Quaterniond q = q_d*q_e.conjugate();
+    return q.w() < 0 ? Eigen::Vector3d(-2*q.vec()) : Eigen::Vector3d(2*q.vec());
+}
+
+
 inline Eigen::Matrix<double,3,1> computeEulerAngles(const Eigen::Matrix<double,3,3> &_R)
 {
 Eigen::Matrix<double,3,1> euler;
@@ -343,4 +372,15 @@ inline Eigen::MatrixXd matrixOrthonormalization(Eigen::MatrixXd R){
    return R;
 }
 
+// same projection on the rotations for 3x3 matrices, with the closed-form eigensolver
+template <int Options>
+Eigen::Matrix<double,3,3,Options> matrixOrthonormalization(const Eigen::Matrix<double,3,3,Options> &R)
+{
+   Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> es;
+   es.computeDirect(R.transpose()*R);
+   Eigen::Vector3d D = es.eigenvalues().cwiseSqrt().cwiseInverse();
+   const Eigen::Matrix3d &V = es.eigenvectors();
+   return R*(V*D.asDiagonal()*V.transpose());
+}
+
 #endif
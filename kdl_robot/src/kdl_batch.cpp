@@ -0,0 +1,174 @@
+#include "kdl_ros_control/kdl_batch.h"
+#include "kdl_ros_control/utils.h"
+
+KDLBatchKinematics::KDLBatchKinematics(const KDL::Chain &_chain)
+{
+    n_ = _chain.getNrOfJoints();
+    segs_.resize(_chain.getNrOfSegments());
+    unsigned int j = 0;
+    for (unsigned int k = 0; k < segs_.size(); k++)
+    {
+        const KDL::Segment &seg = _chain.getSegment(k);
+        SegmentTerms &s = segs_[k];
+        KDL::Joint::JointType type = seg.getJoint().getType();
+        s.jnt = type == KDL::Joint::None ? -1 : j++;
+        s.prismatic = type == KDL::Joint::TransAxis || type == KDL::Joint::TransX ||
+                      type == KDL::Joint::TransY || type == KDL::Joint::TransZ;
+        s.axis = toEigen(seg.getJoint().JointAxis());
+        s.origin = toEigen(seg.getJoint().JointOrigin());
+
+        // the segment pose is affine in (sin(q), cos(q)) for revolute joints and in q
+        // for prismatic ones: recover the terms from a few samples of it
+        KDL::Frame P0 = seg.pose(0.0);
+        if (s.jnt < 0)
+        {
+            s.M0 = toEigen(P0.M);
+            s.p0 = toEigen(P0.p);
+            s.M1.setZero(); s.M2.setZero();
+            s.p1.setZero(); s.p2.setZero();
+        }
+        else if (s.prismatic)
+        {
+            KDL::Frame P1 = seg.pose(1.0);
+            s.M0 = toEigen(P0.M);
+            s.p0 = toEigen(P0.p);
+            s.p1 = toEigen(P1.p - P0.p);
+            s.M1.setZero(); s.M2.setZero();
+            s.p2.setZero();
+        }
+        else
+        {
+            KDL::Frame P90 = seg.pose(M_PI/2), P180 = seg.pose(M_PI);
+            s.M0 = 0.5*(toEigen(P0.M) + toEigen(P180.M));
+            s.M2 = 0.5*(toEigen(P0.M) - toEigen(P180.M));
+            s.M1 = toEigen(P90.M) - s.M0;
+            s.p0 = 0.5*(toEigen(P0.p) + toEigen(P180.p));
+            s.p2 = 0.5*(toEigen(P0.p) - toEigen(P180.p));
+            s.p1 = toEigen(P90.p) - s.p0;
+        }
+    }
+}
+
+void KDLBatchKinematics::fk(const Eigen::MatrixXd &_q, Eigen::MatrixXd &_frames, Eigen::MatrixXd *_jac,
+                            unsigned int _threads)
+{
+    unsigned int n_samples = _q.rows();
+    _frames.resize(n_samples, 12);
+    if (_jac)
+    {
+        _jac->resize(n_samples, 6*n_);
+    }
+    parallelBlocks(n_samples, _threads, [&](unsigned int _k0, unsigned int _len) {
+        fkBlock(_q, _frames, _jac, _k0, _len);
+    });
+}
+
+void KDLBatchKinematics::fkBlock(const Eigen::MatrixXd &_q, Eigen::MatrixXd &_frames, Eigen::MatrixXd *_jac,
+                                 unsigned int _k0, unsigned int _len)
+{
+    // pose of the current segment tip for every sample of the block, R(r,c) in R[r+3*c]
+    Lane R[9], p[3];
+    for (int i = 0; i < 9; i++) R[i].setConstant(i % 4 == 0 ? 1.0 : 0.0);
+    for (int i = 0; i < 3; i++) p[i].setZero();
+
+    Lane q, s, c, M[9], t[3], R_new[9];
+    for (unsigned int k = 0; k < segs_.size(); k++)
+    {
+        const SegmentTerms &seg = segs_[k];
+
+        // segment pose for every sample
+        if (seg.jnt < 0)
+        {
+            for (int i = 0; i < 9; i++) M[i].setConstant(seg.M0(i % 3, i / 3));
+            for (int i = 0; i < 3; i++) t[i].setConstant(seg.p0(i));
+        }
+        else
+        {
+            q.setZero();
+            q.head(_len) = _q.col(seg.jnt).segment(_k0, _len).array();
+            if (seg.prismatic)
+            {
+                for (int i = 0; i < 9; i++) M[i].setConstant(seg.M0(i % 3, i / 3));
+                for (int i = 0; i < 3; i++) t[i] = seg.p0(i) + q*seg.p1(i);
+            }
+            else
+            {
+                s = q.sin();
+                c = q.cos();
+                for (int i = 0; i < 9; i++) M[i] = seg.M0(i % 3, i / 3) + s*seg.M1(i % 3, i / 3) + c*seg.M2(i % 3, i / 3);
+                for (int i = 0; i < 3; i++) t[i] = seg.p0(i) + s*seg.p1(i) + c*seg.p2(i);
+            }
+
+            // joint axis and origin in base frame, parked in the Jacobian columns until
+            // the tip position is known
+            if (_jac)
+            {
+                for (int r = 0; r < 3; r++)
+                {
+                    Lane z = R[r]*seg.axis(0) + R[r+3]*seg.axis(1) + R[r+6]*seg.axis(2);
+                    Lane o = p[r] + R[r]*seg.origin(0) + R[r+3]*seg.origin(1) + R[r+6]*seg.origin(2);
+                    _jac->col(6*seg.jnt + 3 + r).segment(_k0, _len) = z.head(_len).matrix();
+                    _jac->col(6*seg.jnt + r).segment(_k0, _len) = o.head(_len).matrix();
+                }
+            }
+        }
+
+        // compose with the segment pose
+        for (int r = 0; r < 3; r++)
+        {
+            p[r] += R[r]*t[0] + R[r+3]*t[1] + R[r+6]*t[2];
+            for (int cc = 0; cc < 3; cc++)
+            {
+                R_new[r+3*cc] = R[r]*M[3*cc] + R[r+3]*M[3*cc+1] + R[r+6]*M[3*cc+2];
+            }
+        }
+        for (int i = 0; i < 9; i++) R[i] = R_new[i];
+    }
+
+    for (int i = 0; i < 3; i++) _frames.col(i).segment(_k0, _len) = p[i].head(_len).matrix();
+    for (int i = 0; i < 9; i++) _frames.col(3 + i).segment(_k0, _len) = R[i].head(_len).matrix();
+
+    // Jacobian columns: [z x (p_tip - o); z] for revolute, [z; 0] for prismatic joints
+    if (_jac)
+    {
+        Lane z[3];
+        for (int r = 0; r < 3; r++) z[r].setZero();
+        for (unsigned int k = 0; k < segs_.size(); k++)
+        {
+            const SegmentTerms &seg = segs_[k];
+            if (seg.jnt < 0) continue;
+            Eigen::MatrixXd::ColsBlockXpr J = _jac->middleCols(6*seg.jnt, 6);
+            if (seg.prismatic)
+            {
+                J.block(_k0, 0, _len, 3) = J.block(_k0, 3, _len, 3);
+                J.block(_k0, 3, _len, 3).setZero();
+                continue;
+            }
+            for (int r = 0; r < 3; r++) t[r].head(_len) = p[r].head(_len) - J.col(r).segment(_k0, _len).array();
+            for (int r = 0; r < 3; r++) z[r].head(_len) = J.col(3 + r).segment(_k0, _len).array();
+            J.col(0).segment(_k0, _len) = (z[1]*t[2] - z[2]*t[1]).head(_len).matrix();
+            J.col(1).segment(_k0, _len) = (z[2]*t[0] - z[0]*t[2]).head(_len).matrix();
+            J.col(2).segment(_k0, _len) = (z[0]*t[1] - z[1]*t[0]).head(_len).matrix();
+        }
+    }
+}
+
+KDL::Frame KDLBatchKinematics::getFrame(const Eigen::MatrixXd &_frames, unsigned int _k)
+{
+    return KDL::Frame(KDL::Rotation(_frames(_k,3), _frames(_k,6), _frames(_k,9),
+                                    _frames(_k,4), _frames(_k,7), _frames(_k,10),
+                                    _frames(_k,5), _frames(_k,8), _frames(_k,11)),
+                      KDL::Vector(_frames(_k,0), _frames(_k,1), _frames(_k,2)));
+}
+
+void KDLBatchKinematics::setFrame(const KDL::Frame &_F, Eigen::MatrixXd &_frames, unsigned int _k)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        _frames(_k,i) = _F.p(i);
+        for (int j = 0; j < 3; j++)
+        {
+            _frames(_k,3 + i + 3*j) = _F.M(i,j);
+        }
+    }
+}
@@ -1,8 +1,9 @@
 #include "kdl_ros_control/kdl_control.h"
 
-KDLController::KDLController(KDLRobot &_robot)
+KDLController::KDLController(KDLRobot &_robot) : robot7_(_robot)
 {
     robot_ = &_robot;
+    qpHorizon_ = 0.05;
 }
 
 //IMPLEMENTAZIONE PROF
@@ -35,8 +36,8 @@ Eigen::VectorXd KDLController::idCntr(KDL::Frame &_desPos,
    
    // calculate gain matrices
    Eigen::Matrix<double,6,6> Kp, Kd;
-   Kp=Eigen::MatrixXd::Zero(6,6);
-   Kd=Eigen::MatrixXd::Zero(6,6);
+   Kp.setZero();
+   Kd.setZero();
    Kp.block(0,0,3,3) = _Kpp*Eigen::Matrix3d::Identity(); //costruisco la matrice 3x3 dei guadagni sull'errore di posizione
    Kp.block(3,3,3,3) = _Kpo*Eigen::Matrix3d::Identity(); //costruisco la matrice 3x3 dei guadagni sull'errore di orientamento
    Kd.block(0,0,3,3) = _Kdp*Eigen::Matrix3d::Identity();//costruisco la matrice 3x3 dei guadagni sulla derivata dell'errore di posizione
@@ -46,12 +47,12 @@ Eigen::VectorXd KDLController::idCntr(KDL::Frame &_desPos,
 
 
     //CONVERSIONE DA JACOBIAN A MATRIX SI PUO' FARE SEMPLICEMENTE COSI
-    Eigen::Matrix<double,6,7> J = robot_->getEEJacobian().data;
+    Eigen::Matrix<double,6,7> J = robot7_.getEEJacobian();
 
    Eigen::Matrix<double,7,7> I = Eigen::Matrix<double,7,7>::Identity();
-   Eigen::Matrix<double,7,7> M = robot_->getJsim();
+   Eigen::Matrix<double,7,7> M = robot7_.getJsim();
    //Eigen::Matrix<double,7,6> Jpinv = weightedPseudoInverse(M,J);
-   Eigen::Matrix<double,7,6> Jpinv = pseudoinverse(J);
+   Eigen::Matrix<double,7,6> Jpinv = dampedPseudoinverse(J);
 
    // position
    Eigen::Vector3d p_d(_desPos.p.data);
@@ -89,7 +90,7 @@ Eigen::VectorXd KDLController::idCntr(KDL::Frame &_desPos,
 //                                                                        R_d,
  //                                                                       R_e);   
     
-   Eigen::Matrix<double,3,1> e_o = computeOrientationError(R_d,R_e);
+   Eigen::Matrix<double,3,1> e_o = computeOrientationErrorQuat(R_d,R_e);
    Eigen::Matrix<double,3,1> dot_e_o = computeOrientationVelocityError(omega_d,
                                                                        omega_e,
                                                                        R_d,
@@ -102,10 +103,6 @@ Eigen::VectorXd KDLController::idCntr(KDL::Frame &_desPos,
    dot_x_tilde << dot_e_p, -omega_e;//dot_e_o;
    dot_dot_x_d << dot_dot_p_d, dot_dot_r_d;
 
-   // null space control
-   double cost;
-   Eigen::VectorXd grad = gradientJointLimits(robot_->getJntValues(),robot_->getJntLimits(),cost);
-
 //    std::cout << "---------------------" << std::endl;
 //    std::cout << "p_d: " << std::endl << p_d << std::endl;
 //    std::cout << "p_e: " << std::endl << p_e << std::endl;
@@ -140,10 +137,10 @@ Eigen::VectorXd KDLController::idCntr(KDL::Frame &_desPos,
 
     //creiamo una matrice contenente y = xd_dot_dot - J_dot*q_dot + Kd*x_tilde_dot + Kp*x_tilde
     Eigen::Matrix<double,6,1> y;
-    y << dot_dot_x_d - robot_->getEEJacDotqDot() + Kd*dot_x_tilde + Kp*x_tilde;
+    y << dot_dot_x_d - robot7_.getEEJacDotqDot() + Kd*dot_x_tilde + Kp*x_tilde;
 
     //restituiamo l'ingresso di controllo u = By + n
-       return M * (Jpinv*y)+ robot_->getGravity() + robot_->getCoriolis();
+       return M * (Jpinv*y)+ robot7_.getGravity() + robot7_.getCoriolis();
            //(I-Jpinv*J)*(/*- 10*grad */- 1*robot_->getJntVelocities())
 
     
@@ -163,9 +160,9 @@ Eigen::VectorXd KDLController::idCntr(KDL::Frame &_desPos,
    Kd = _Kdp*Eigen::Matrix3d::Identity();//costruisco la matrice 3x3 dei guadagni sulla derivata dell'errore di posizione
    
 
-   Eigen::Matrix<double,6,7> J = robot_->getEEJacobian().data;
+   Eigen::Matrix<double,6,7> J = robot7_.getEEJacobian();
    Eigen::Matrix<double,3,7> J_red = J.topRows(3);
-   Eigen::Matrix<double,7,7> M = robot_->getJsim();
+   Eigen::Matrix<double,7,7> M = robot7_.getJsim();
    Eigen::Matrix<double,7,3> Jpinv = pseudoinverse(J_red);
 
    // position
@@ -194,9 +191,318 @@ Eigen::VectorXd KDLController::idCntr(KDL::Frame &_desPos,
 Eigen::Matrix<double,3,1> y;
 
     y << dot_dot_x_d - robot_->getEEJacDotqDot_red() + Kd*dot_x_tilde + Kp*x_tilde;
-return M * (Jpinv*y)+ robot_->getGravity() + robot_->getCoriolis();
+return M * (Jpinv*y)+ robot7_.getGravity() + robot7_.getCoriolis();
 
            
 }
 
 
+
+Eigen::VectorXd KDLController::osCntr(KDL::Frame &_desPos,
+                                      KDL::Twist &_desVel,
+                                      KDL::Twist &_desAcc,
+                                      double _Kpp, double _Kpo,
+                                      double _Kdp, double _Kdo,
+                                      const Eigen::VectorXd &_tau0)
+{
+    Eigen::Matrix<double,6,7> J = robot7_.getEEJacobian();
+    Eigen::Matrix<double,7,7> M = robot7_.getJsim();
+    Eigen::Matrix<double,6,1> y = cartesianAcc(_desPos,_desVel,_desAcc,_Kpp,_Kpo,_Kdp,_Kdo);
+
+    // Lambda^-1 = J*M^-1*J^T from the Cholesky factor of M; Lambda is never formed, its
+    // products come from one LDLT of Lambda^-1, lightly damped near singularities
+    Eigen::LLT< Eigen::Matrix<double,7,7> > llt(M);
+    Eigen::Matrix<double,7,6> MinvJt = llt.solve(J.transpose());
+    Eigen::Matrix<double,6,6> Linv = J*MinvJt;
+    Linv.diagonal().array() += 1e-6;
+    Eigen::LDLT< Eigen::Matrix<double,6,6> > ldlt(Linv);
+
+    Eigen::Matrix<double,7,1> tau = J.transpose()*ldlt.solve(y);
+    if (_tau0.size() == 7)
+    {
+        // N^T*tau0 = tau0 - J^T*Lambda*(J*M^-1*tau0)
+        tau += _tau0 - J.transpose()*ldlt.solve(MinvJt.transpose()*_tau0);
+    }
+    return tau + robot7_.getGravity() + robot7_.getCoriolis();
+}
+
+Eigen::Matrix<double,6,1> KDLController::cartesianAcc(KDL::Frame &_desPos,
+                                                      KDL::Twist &_desVel,
+                                                      KDL::Twist &_desAcc,
+                                                      double _Kpp, double _Kpo,
+                                                      double _Kdp, double _Kdo)
+{
+    KDL::Frame F_e = robot_->getEEFrame();
+    KDL::Twist V_e = robot_->getEEVelocity();
+
+    Eigen::Matrix<double,3,3,Eigen::RowMajor> R_d(_desPos.M.data);
+    Eigen::Matrix<double,3,3,Eigen::RowMajor> R_e(F_e.M.data);
+    Eigen::Matrix<double,6,1> x_tilde, dot_x_tilde, y;
+    x_tilde << computeLinearError(toEigen(_desPos.p),toEigen(F_e.p)),
+               computeOrientationErrorQuat(matrixOrthonormalization(R_d),matrixOrthonormalization(R_e));
+    dot_x_tilde = toEigen(_desVel) - toEigen(V_e);
+
+    y << toEigen(_desAcc.vel) + _Kdp*dot_x_tilde.head<3>() + _Kpp*x_tilde.head<3>(),
+         toEigen(_desAcc.rot) + _Kdo*dot_x_tilde.tail<3>() + _Kpo*x_tilde.tail<3>();
+    return y - robot7_.getEEJacDotqDot();
+}
+
+// task stack storage, at most 7 rows, on the stack
+typedef Eigen::Matrix<double,Eigen::Dynamic,7,0,7,7> StackJacobian;
+typedef Eigen::Matrix<double,Eigen::Dynamic,1,0,7,1> StackVector;
+typedef Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,0,7,7> StackMatrix;
+
+// one level of the stack: ddq += A^#M*(_ddx - _J*ddq) with A = _J*P, then removes the
+// directions of A from P; _ddx already holds the Jdot*dq term
+static void stackTask(const Eigen::LLT< Eigen::Matrix<double,7,7> > &_llt, const StackJacobian &_J,
+                      const StackVector &_ddx, Eigen::Matrix<double,7,1> &_ddq, Eigen::Matrix<double,7,7> &_P)
+{
+    StackJacobian A = _J*_P;
+    Eigen::Matrix<double,7,Eigen::Dynamic,0,7,7> MinvAt = _llt.solve(A.transpose());
+
+    // A*M^-1*A^T is singular when the task is rank deficient in the directions left by
+    // the higher ones: regularized inverse e/(e^2 + eps^2) of its eigenvalues, which is
+    // exactly zero on the null directions and damped near them
+    Eigen::SelfAdjointEigenSolver<StackMatrix> es(A*MinvAt);
+    StackVector d = es.eigenvalues();
+    for (int i = 0; i < d.size(); i++)
+    {
+        d(i) = std::max(d(i), 0.0)/(d(i)*d(i) + 1e-12);
+    }
+    Eigen::Matrix<double,7,Eigen::Dynamic,0,7,7> B = MinvAt*es.eigenvectors();
+    Eigen::Matrix<double,7,Eigen::Dynamic,0,7,7> Ainv = B*d.asDiagonal()*es.eigenvectors().transpose();
+    _ddq += Ainv*(_ddx - _J*_ddq);
+    _P -= Ainv*A;
+}
+
+// cost sum_i r_i^2/((q_max_i - q_i)*(q_i - q_min_i)) of gradientJointLimits and its gradient,
+// on fixed-size storage and without its output. Both distances are clamped to a small positive
+// value: past a limit the cost stays large and the gradient keeps pointing back inside, instead
+// of the cost turning negative
+static double jointLimitCost(const Eigen::Matrix<double,7,1> &_q, const Eigen::Matrix<double,7,2> &_limits,
+                             Eigen::Matrix<double,7,1> &_grad)
+{
+    const double d_min = 1e-3;
+    double cost = 0.0;
+    for (int i = 0; i < 7; i++)
+    {
+        double r = _limits(i,1) - _limits(i,0);
+        double d_hi = std::max(_limits(i,1) - _q(i), d_min), d_lo = std::max(_q(i) - _limits(i,0), d_min);
+        cost += r*r/(d_hi*d_lo);
+        _grad(i) = r*r*(d_lo - d_hi)/(d_hi*d_hi*d_lo*d_lo);
+    }
+    return cost;
+}
+
+Eigen::VectorXd KDLController::stackCntr(KDL::Frame &_desPos,
+                                         KDL::Twist &_desVel,
+                                         KDL::Twist &_desAcc,
+                                         double _Kpp, double _Kpo,
+                                         double _Kdp, double _Kdo,
+                                         double _Kjl, double _jlActivation,
+                                         const Eigen::VectorXd &_q_posture,
+                                         double _Kpq, double _Kdq)
+{
+    Eigen::Matrix<double,7,7> M = robot7_.getJsim();
+    Eigen::LLT< Eigen::Matrix<double,7,7> > llt(M);
+    Eigen::Matrix<double,7,7> P = Eigen::Matrix<double,7,7>::Identity();
+    Eigen::Matrix<double,7,1> ddq = Eigen::Matrix<double,7,1>::Zero();
+    Eigen::Matrix<double,7,1> q = robot7_.getJntValues(), dq = robot7_.getJntVelocities();
+
+    // 1) end-effector pose
+    StackJacobian J = robot7_.getEEJacobian();
+    StackVector ddx = cartesianAcc(_desPos,_desVel,_desAcc,_Kpp,_Kpo,_Kdp,_Kdo);
+    stackTask(llt, J, ddx, ddq, P);
+
+    // 2) joint-limit avoidance, d(cost)/dt = grad^T*dq; grad_dot*dq by a finite difference
+    // of the gradient along dq
+    const Eigen::Matrix<double,7,2> &limits = robot7_.getJntLimits();
+    Eigen::Matrix<double,7,1> grad, grad_eps;
+    double cost = jointLimitCost(q, limits, grad);
+    if (cost > _jlActivation)
+    {
+        double eps = 1e-6;
+        jointLimitCost(q + eps*dq, limits, grad_eps);
+        J = grad.transpose();
+        ddx.resize(1);
+        ddx(0) = -_Kjl*(cost - _jlActivation) - 2*std::sqrt(_Kjl)*grad.dot(dq) - (grad_eps - grad).dot(dq)/eps;
+        stackTask(llt, J, ddx, ddq, P);
+    }
+
+    // 3) joint posture
+    if (_q_posture.size() == 7)
+    {
+        J = Eigen::Matrix<double,7,7>::Identity();
+        ddx = _Kpq*(_q_posture - q) - _Kdq*dq;
+        stackTask(llt, J, ddx, ddq, P);
+    }
+
+    return M*ddq + robot7_.getGravity() + robot7_.getCoriolis();
+}
+
+void KDLController::setQpLimits(const Eigen::VectorXd &_tau_max, const Eigen::VectorXd &_dq_max, double _horizon)
+{
+    qpTauMax_ = _tau_max;
+    qpDqMax_ = _dq_max;
+    qpHorizon_ = _horizon;
+}
+
+bool KDLController::addWorkspacePlane(const Eigen::Vector3d &_n, double _d)
+{
+    if (14 + planes_.rows() >= KDLQp::MAX_ROWS)
+    {
+        printf("too many workspace planes, ignored \n");
+        return false;
+    }
+    planes_.conservativeResize(planes_.rows() + 1, 4);
+    planes_.bottomRows(1) << _n.transpose(), _d;
+    return true;
+}
+
+void KDLController::clearWorkspacePlanes()
+{
+    planes_.resize(0, 4);
+}
+
+const KDLQp::Stats &KDLController::getQpStats()
+{
+    return qp_.getStats();
+}
+
+Eigen::VectorXd KDLController::qpCntr(KDL::Frame &_desPos,
+                                      KDL::Twist &_desVel,
+                                      KDL::Twist &_desAcc,
+                                      double _Kpp, double _Kpo,
+                                      double _Kdp, double _Kdo,
+                                      const Eigen::VectorXd &_ddq_ref)
+{
+    Eigen::Matrix<double,6,7> J = robot7_.getEEJacobian();
+    Eigen::Matrix<double,7,7> M = robot7_.getJsim();
+    Eigen::Matrix<double,7,1> h = robot7_.getGravity() + robot7_.getCoriolis();
+    Eigen::Matrix<double,7,1> q = robot7_.getJntValues(), dq = robot7_.getJntVelocities();
+    Eigen::Matrix<double,6,1> y = cartesianAcc(_desPos,_desVel,_desAcc,_Kpp,_Kpo,_Kdp,_Kdo);
+
+    // min |J*ddq - y|^2 + w*|ddq - ddq_ref|^2
+    double w = 1e-3;
+    KDLQp::MatrixN P = J.transpose()*J;
+    P.diagonal().array() += w;
+    KDLQp::VectorN g = -J.transpose()*y;
+    if (_ddq_ref.size() == 7) g -= w*_ddq_ref;
+
+    int n_tau = qpTauMax_.size() == 7 ? 7 : 0;
+    KDLQp::Constraints A(n_tau + 7 + planes_.rows(), 7);
+    KDLQp::Bounds l(A.rows()), u(A.rows());
+    if (n_tau)
+    {
+        A.topRows(7) = M;
+        l.head(7) = -qpTauMax_ - h;
+        u.head(7) = qpTauMax_ - h;
+    }
+
+    // joint position (q + dq*T + ddq*T^2/2) and velocity (dq + ddq*T) within the limits
+    double T = qpHorizon_;
+    const Eigen::Matrix<double,7,2> &limits = robot7_.getJntLimits();
+    A.middleRows(n_tau, 7).setIdentity();
+    for (int i = 0; i < 7; i++)
+    {
+        double lo = 2*(limits(i,0) - q(i) - dq(i)*T)/(T*T);
+        double hi = 2*(limits(i,1) - q(i) - dq(i)*T)/(T*T);
+        if (qpDqMax_.size() == 7)
+        {
+            lo = std::max(lo, (-qpDqMax_(i) - dq(i))/T);
+            hi = std::min(hi, (qpDqMax_(i) - dq(i))/T);
+        }
+        if (lo > hi) lo = hi = 0.5*(lo + hi);   // already beyond a limit: brake
+        l(n_tau + i) = lo;
+        u(n_tau + i) = hi;
+    }
+
+    // n^T*(p + v*T + (J*ddq + Jdot*dq)*T^2/2) <= d
+    if (planes_.rows() > 0)
+    {
+        Eigen::Vector3d p = toEigen(robot_->getEEFrame().p), v = toEigen(robot_->getEEVelocity().vel);
+        Eigen::Vector3d a0 = robot7_.getEEJacDotqDot().head<3>();
+        for (int k = 0; k < planes_.rows(); k++)
+        {
+            Eigen::Vector3d n = planes_.block<1,3>(k,0).transpose();
+            int r = n_tau + 7 + k;
+            A.row(r) = n.transpose()*J.topRows<3>();
+            l(r) = -1e20;
+            u(r) = 2*(planes_(k,3) - n.dot(p + v*T))/(T*T) - n.dot(a0);
+        }
+    }
+
+    KDLQp::VectorN ddq;
+    if (qp_.solve(P, g, A, l, u, ddq) == KDLQp::SOLVED)
+    {
+        return M*ddq + h;
+    }
+
+    // not converged (infeasible, or too few iterations): the last iterate may violate the
+    // constraints. Keep the joint bounds, which act on ddq directly, and clamp the torque
+    Eigen::Matrix<double,7,1> tau = M*ddq.cwiseMax(l.segment<7>(n_tau)).cwiseMin(u.segment<7>(n_tau)) + h;
+    if (n_tau)
+    {
+        tau = tau.cwiseMax(-qpTauMax_).cwiseMin(qpTauMax_);
+    }
+    return tau;
+}
+
+Eigen::VectorXd KDLController::cartImpCntr(KDL::Frame &_desPos,
+                                           KDL::Twist &_desVel,
+                                           const Eigen::Matrix<double,6,1> &_stiffness,
+                                           const Eigen::Matrix<double,6,1> &_damping,
+                                           double _nullStiffness,
+                                           double _nullDamping,
+                                           const Eigen::VectorXd &_q_null)
+{
+    Eigen::Matrix<double,6,7> J = robot7_.getEEJacobian();
+    Eigen::Matrix<double,7,7> M = robot7_.getJsim();
+    Eigen::Matrix<double,7,1> q = robot7_.getJntValues(), dq = robot7_.getJntVelocities();
+    KDL::Frame F_e = robot_->getEEFrame();
+
+    // pose and velocity errors in the end-effector frame
+    Eigen::Matrix<double,3,3,Eigen::RowMajor> R_d(_desPos.M.data);
+    Eigen::Matrix<double,3,3,Eigen::RowMajor> R_e(F_e.M.data);
+    Eigen::Matrix<double,6,6> R = spatialRotation(F_e.M);
+    Eigen::Matrix<double,6,1> x_tilde, dot_x_tilde;
+    x_tilde << computeLinearError(toEigen(_desPos.p),toEigen(F_e.p)),
+               computeOrientationErrorQuat(matrixOrthonormalization(R_d),matrixOrthonormalization(R_e));
+    x_tilde = R.transpose()*x_tilde;
+    dot_x_tilde = R.transpose()*(toEigen(_desVel) - toEigen(robot_->getEEVelocity()));
+
+    // task-space inertia in the end-effector frame from the Cholesky factor of M, damping
+    // d_i = 2*zeta_i*sqrt(k_i*Lambda_ii)
+    Eigen::LLT< Eigen::Matrix<double,7,7> > llt(M);
+    Eigen::Matrix<double,7,6> MinvJt = llt.solve(J.transpose());
+    Eigen::Matrix<double,6,6> Linv = J*MinvJt;
+    Linv.diagonal().array() += 1e-6;
+    Eigen::LDLT< Eigen::Matrix<double,6,6> > ldlt(Linv);
+    Eigen::Matrix<double,6,6> Lambda_e = R.transpose()*ldlt.solve(R);
+    Eigen::Matrix<double,6,1> d = 2*_damping.cwiseProduct((_stiffness.cwiseProduct(Lambda_e.diagonal())).cwiseSqrt());
+
+    Eigen::Matrix<double,6,1> F = R*(_stiffness.cwiseProduct(x_tilde) + d.cwiseProduct(dot_x_tilde));
+    Eigen::Matrix<double,7,1> tau = J.transpose()*F;
+
+    // null space: joint spring-damper, N^T*tau0 = tau0 - J^T*Lambda*J*M^-1*tau0
+    Eigen::Matrix<double,7,1> tau0 = -2*_nullDamping*(_nullStiffness*M.diagonal()).cwiseSqrt().cwiseProduct(dq);
+    if (_q_null.size() == 7) tau0 += _nullStiffness*(_q_null - q);
+    tau += tau0 - J.transpose()*ldlt.solve(MinvJt.transpose()*tau0);
+
+    return tau + robot7_.getGravity() + robot7_.getCoriolis();
+}
+
+Eigen::VectorXd KDLController::jntImpCntr(KDL::JntArray &_qd,
+                                          KDL::JntArray &_dqd,
+                                          const Eigen::VectorXd &_stiffness,
+                                          const Eigen::VectorXd &_damping)
+{
+    Eigen::VectorXd q = robot_->getJntValues();
+    Eigen::VectorXd dq = robot_->getJntVelocities();
+    Eigen::VectorXd M_ii = robot_->getJsim().diagonal();
+
+    // d_i = 2*zeta_i*sqrt(k_i*M_ii)
+    Eigen::VectorXd d = 2*_damping.cwiseProduct((_stiffness.cwiseProduct(M_ii)).cwiseSqrt());
+    return _stiffness.cwiseProduct(_qd.data - q) + d.cwiseProduct(_dqd.data - dq)
+            + robot_->getCoriolis() + robot_->getGravity();
+}
@@ -0,0 +1,213 @@
+#include "kdl_ros_control/kdl_dynamics.h"
+#include "kdl_ros_control/utils.h"
+
+KDLDynamics::KDLDynamics(const KDL::Chain &_chain, const KDL::Vector &_grav)
+{
+    chain_ = _chain;
+    n_ = chain_.getNrOfJoints();
+    a_grav_ = -toEigen(_grav);
+
+    bodies_.resize(chain_.getNrOfSegments());
+    unsigned int j = 0;
+    for (unsigned int k = 0; k < bodies_.size(); k++)
+    {
+        const KDL::Segment &seg = chain_.getSegment(k);
+        Body &b = bodies_[k];
+        switch (seg.getJoint().getType())
+        {
+        case KDL::Joint::None:
+            b.jnt = -1;
+            b.prismatic = false;
+            break;
+        case KDL::Joint::TransAxis:
+        case KDL::Joint::TransX:
+        case KDL::Joint::TransY:
+        case KDL::Joint::TransZ:
+            b.jnt = j++;
+            b.prismatic = true;
+            break;
+        default:
+            b.jnt = j++;
+            b.prismatic = false;
+        }
+
+        // KDL stores the rotational inertia about the tip frame origin
+        const KDL::RigidBodyInertia &I = seg.getInertia();
+        KDL::RotationalInertia I_o = I.getRotationalInertia();
+        Eigen::Matrix3d I_tip;
+        I_tip << toEigen(I_o*KDL::Vector(1,0,0)), toEigen(I_o*KDL::Vector(0,1,0)), toEigen(I_o*KDL::Vector(0,0,1));
+        b.m = I.getMass();
+        b.cog = toEigen(I.getCOG());
+        b.I_c = I_tip + b.m*skew(b.cog)*skew(b.cog);
+    }
+
+    J_.resize(6,n_);
+    J_dot_.resize(6,n_);
+    M_.resize(n_,n_);
+    c_.resize(n_);
+    g_.resize(n_);
+    J_.setZero();
+    J_dot_.setZero();
+    J_dot_q_dot_.setZero();
+    M_.setZero();
+    c_.setZero();
+    g_.setZero();
+}
+
+void KDLDynamics::forward(const KDL::JntArray &_q, const KDL::JntArray &_dq)
+{
+    KDL::Frame T = KDL::Frame::Identity();
+    Eigen::Vector3d V_w = Eigen::Vector3d::Zero(), V_v = Eigen::Vector3d::Zero();
+    Eigen::Vector3d A_w = Eigen::Vector3d::Zero(), A_v = Eigen::Vector3d::Zero();
+
+    for (unsigned int k = 0; k < bodies_.size(); k++)
+    {
+        const KDL::Segment &seg = chain_.getSegment(k);
+        Body &b = bodies_[k];
+        double q = 0.0;
+
+        if (b.jnt >= 0)
+        {
+            q = _q(b.jnt);
+            double dq = _dq(b.jnt);
+
+            // joint motion subspace in base frame, at the base origin
+            Eigen::Vector3d z = toEigen(T.M*seg.getJoint().JointAxis());
+            if (b.prismatic)
+            {
+                b.s_w.setZero();
+                b.s_v = z;
+            }
+            else
+            {
+                Eigen::Vector3d p = toEigen(T*seg.getJoint().JointOrigin());
+                b.s_w = z;
+                b.s_v = p.cross(z);
+            }
+
+            // V_k = V_k-1 + s*dq,  A_k = A_k-1 + (V_k x s)*dq  (q_ddot = 0)
+            V_w += b.s_w*dq;
+            V_v += b.s_v*dq;
+            A_w += V_w.cross(b.s_w)*dq;
+            A_v += (V_w.cross(b.s_v) + V_v.cross(b.s_w))*dq;
+        }
+
+        T = T*seg.pose(q);
+        b.V_w = V_w;
+        b.V_v = V_v;
+        b.A_w = A_w;
+        b.A_v = A_v;
+
+        // body inertia in base frame, about the base origin
+        Eigen::Matrix3d R = toEigen(T.M);
+        Eigen::Vector3d c = toEigen(T.p) + R*b.cog;
+        b.h = b.m*c;
+        b.I_o = R*b.I_c*R.transpose() - b.m*skew(c)*skew(c);
+    }
+
+    // flange pose and twist
+    Eigen::Vector3d p_e = toEigen(T.p);
+    Eigen::Vector3d dp_e = V_v + V_w.cross(p_e);
+    F_tip_ = T;
+    V_tip_ = KDL::Twist(toKDL(dp_e), toKDL(V_w));
+
+    // Jacobian and its time derivative with reference point at the flange
+    J_dot_q_dot_.setZero();
+    for (unsigned int k = 0; k < bodies_.size(); k++)
+    {
+        const Body &b = bodies_[k];
+        if (b.jnt < 0) continue;
+
+        Eigen::Vector3d ds_w = b.V_w.cross(b.s_w);
+        Eigen::Vector3d ds_v = b.V_w.cross(b.s_v) + b.V_v.cross(b.s_w);
+        J_.col(b.jnt) << b.s_v + b.s_w.cross(p_e), b.s_w;
+        J_dot_.col(b.jnt) << ds_v + ds_w.cross(p_e) + b.s_w.cross(dp_e), ds_w;
+        J_dot_q_dot_ += J_dot_.col(b.jnt)*_dq(b.jnt);
+    }
+}
+
+void KDLDynamics::backward()
+{
+    double m_sub = 0.0;
+    Eigen::Vector3d h_sub = Eigen::Vector3d::Zero();
+    Eigen::Matrix3d I_sub = Eigen::Matrix3d::Zero();
+    Eigen::Vector3d f_w = Eigen::Vector3d::Zero(), f_v = Eigen::Vector3d::Zero();
+
+    for (int k = bodies_.size() - 1; k >= 0; k--)
+    {
+        Body &b = bodies_[k];
+
+        // bias force I*A + V x* (I*V), accumulated towards the base
+        Eigen::Vector3d l_w = b.I_o*b.V_w + b.h.cross(b.V_v);
+        Eigen::Vector3d l_v = b.m*b.V_v + b.V_w.cross(b.h);
+        f_w += b.I_o*b.A_w + b.h.cross(b.A_v) + b.V_w.cross(l_w) + b.V_v.cross(l_v);
+        f_v += b.m*b.A_v + b.A_w.cross(b.h) + b.V_w.cross(l_v);
+
+        // composite rigid body inertia
+        m_sub += b.m;
+        h_sub += b.h;
+        I_sub += b.I_o;
+
+        b.m_sub = m_sub;
+        b.h_sub = h_sub;
+        b.I_sub = I_sub;
+        b.f_w = f_w;
+        b.f_v = f_v;
+
+        if (b.jnt < 0) continue;
+
+        c_(b.jnt) = b.s_w.dot(f_w) + b.s_v.dot(f_v);
+        g_(b.jnt) = b.s_w.dot(h_sub.cross(a_grav_)) + b.s_v.dot(m_sub*a_grav_);
+
+        // CRBA: F = I_sub*s, M(i,j) = s_j'*F for every joint j up to this one
+        Eigen::Vector3d F_w = I_sub*b.s_w + h_sub.cross(b.s_v);
+        Eigen::Vector3d F_v = m_sub*b.s_v + b.s_w.cross(h_sub);
+        for (int l = k; l >= 0; l--)
+        {
+            const Body &a = bodies_[l];
+            if (a.jnt < 0) continue;
+            M_(a.jnt,b.jnt) = a.s_w.dot(F_w) + a.s_v.dot(F_v);
+            M_(b.jnt,a.jnt) = M_(a.jnt,b.jnt);
+        }
+    }
+}
+
+const KDL::Frame &KDLDynamics::getFrame()
+{
+    return F_tip_;
+}
+
+const KDL::Twist &KDLDynamics::getTwist()
+{
+    return V_tip_;
+}
+
+const Eigen::Matrix<double,6,Eigen::Dynamic> &KDLDynamics::getJacobian()
+{
+    return J_;
+}
+
+const Eigen::Matrix<double,6,Eigen::Dynamic> &KDLDynamics::getJacobianDot()
+{
+    return J_dot_;
+}
+
+const Eigen::Matrix<double,6,1> &KDLDynamics::getJacDotqDot()
+{
+    return J_dot_q_dot_;
+}
+
+const Eigen::MatrixXd &KDLDynamics::getJsim()
+{
+    return M_;
+}
+
+const Eigen::VectorXd &KDLDynamics::getCoriolis()
+{
+    return c_;
+}
+
+const Eigen::VectorXd &KDLDynamics::getGravity()
+{
+    return g_;
+}
@@ -0,0 +1,394 @@
+#include "kdl_ros_control/kdl_ik.h"
+#include "kdl_ros_control/utils.h"
+#include <stdio.h>
+#include <chrono>
+
+// DH twist angles of the SRS arm
+static const double ALPHA[7] = {-M_PI/2, M_PI/2, M_PI/2, -M_PI/2, -M_PI/2, M_PI/2, 0.0};
+
+static double clampUnit(double x)
+{
+    return std::max(-1.0, std::min(1.0, x));
+}
+
+KDLAnalyticIK::KDLAnalyticIK(const KDL::Chain &_chain, const KDL::JntArray &_q_min, const KDL::JntArray &_q_max)
+{
+    chain_ = _chain;
+    valid_ = false;
+    d_bs_ = d_se_ = d_ew_ = d_wf_ = 0.0;
+    sign_.setOnes();
+    if (chain_.getNrOfJoints() != 7)
+    {
+        printf("analytic inverse kinematics needs a 7 joints chain, got %d \n", chain_.getNrOfJoints());
+        return;
+    }
+    q_min_ = _q_min.data;
+    q_max_ = _q_max.data;
+
+    // joint origins at the zero configuration: shoulder on joint 2, elbow on joint 4,
+    // wrist on joint 6
+    std::vector<KDL::Vector> origins;
+    KDL::Frame T = KDL::Frame::Identity();
+    for (unsigned int k = 0; k < chain_.getNrOfSegments(); k++)
+    {
+        const KDL::Segment &seg = chain_.getSegment(k);
+        T = T*seg.pose(0.0);
+        if (seg.getJoint().getType() != KDL::Joint::None)
+        {
+            origins.push_back(T.p);
+        }
+    }
+    d_bs_ = origins[1].Norm();
+    d_se_ = (origins[3] - origins[1]).Norm();
+    d_ew_ = (origins[5] - origins[3]).Norm();
+    d_wf_ = (T.p - origins[5]).Norm();
+
+    // joint directions and flange offset: the sign combination for which the DH model
+    // reproduces the chain forward kinematics
+    Vector7 q_test[3];
+    q_test[0] << 0.3, -0.5, 0.7, -1.1, 0.4, 0.9, -0.6;
+    q_test[1] << -1.2, 0.8, -0.3, 1.5, -0.9, -0.4, 1.1;
+    q_test[2] << 2.1, 1.3, 1.7, -0.2, 2.5, 1.6, 0.8;
+    KDL::Frame F_tool = dhFk(Vector7::Zero()).Inverse()*chainFk(Vector7::Zero());
+    double best_err = 1e9;
+    Vector7 best_sign = sign_;
+    for (int c = 0; c < 128; c++)
+    {
+        Vector7 s;
+        for (int i = 0; i < 7; i++)
+        {
+            s(i) = (c >> i) & 1 ? -1.0 : 1.0;
+        }
+        double err = 0.0;
+        for (int t = 0; t < 3; t++)
+        {
+            KDL::Frame F_dh = dhFk(s.cwiseProduct(q_test[t]))*F_tool;
+            KDL::Twist e = KDL::diff(F_dh, chainFk(q_test[t]));
+            err += e.vel.Norm() + e.rot.Norm();
+        }
+        if (err < best_err)
+        {
+            best_err = err;
+            best_sign = s;
+        }
+    }
+    sign_ = best_sign;
+    F_tool_inv_ = F_tool.Inverse();
+    valid_ = best_err < 1e-6;
+    if (!valid_)
+    {
+        printf("chain is not a spherical-rotational-spherical arm, analytic inverse kinematics disabled \n");
+    }
+}
+
+bool KDLAnalyticIK::isValid()
+{
+    return valid_;
+}
+
+int KDLAnalyticIK::solve(const KDL::Frame &_F, double _psi, Solutions &_sols)
+{
+    if (!valid_)
+    {
+        return 0;
+    }
+
+    // DH flange pose, wrist centre and shoulder-wrist vector
+    KDL::Frame F = _F*F_tool_inv_;
+    Eigen::Matrix3d R = toEigen(F.M);
+    Eigen::Vector3d x_sw = toEigen(F.p) - d_wf_*R.col(2) - Eigen::Vector3d(0, 0, d_bs_);
+    double l_sw = x_sw.norm();
+    double c4 = (l_sw*l_sw - d_se_*d_se_ - d_ew_*d_ew_)/(2*d_se_*d_ew_);
+    if (std::fabs(c4) > 1.0 + 1e-9)
+    {
+        return 0;
+    }
+
+    // rotation by the arm angle about the shoulder-wrist axis
+    Eigen::Matrix3d U = skew(x_sw/l_sw);
+    Eigen::Matrix3d R_psi = Eigen::Matrix3d::Identity() + std::sin(_psi)*U + (1 - std::cos(_psi))*U*U;
+
+    int n_sols = 0;
+    Vector7 q;
+    for (int gc4 = 1; gc4 >= -1; gc4 -= 2)
+    {
+        q(3) = gc4*std::acos(clampUnit(c4));
+        double q1_ref, q2_ref;
+        referencePlane(x_sw, q(3), q1_ref, q2_ref);
+        Eigen::Matrix3d R_03 = R_psi*shoulderRotation(q1_ref, q2_ref, 0.0);
+        Eigen::Matrix3d R_34;
+        R_34 << std::cos(q(3)), 0, -std::sin(q(3)),
+                std::sin(q(3)), 0,  std::cos(q(3)),
+                0,             -1,  0;
+        Eigen::Matrix3d R_47 = (R_03*R_34).transpose()*R;
+
+        for (int gc2 = 1; gc2 >= -1; gc2 -= 2)
+        {
+            q(1) = gc2*std::acos(clampUnit(R_03(2,1)));
+            if (std::fabs(std::sin(q(1))) < 1e-9)
+            {
+                // shoulder singularity, joints 1 and 3 aligned: keep joint 1 at zero
+                if (gc2 < 0) continue;
+                q(0) = 0.0;
+                q(2) = R_03(2,1) > 0 ? std::atan2(R_03(1,0), R_03(0,0)) : std::atan2(R_03(1,0), -R_03(0,0));
+            }
+            else
+            {
+                q(0) = std::atan2(gc2*R_03(1,1), gc2*R_03(0,1));
+                q(2) = std::atan2(-gc2*R_03(2,2), -gc2*R_03(2,0));
+            }
+
+            for (int gc6 = 1; gc6 >= -1; gc6 -= 2)
+            {
+                q(5) = gc6*std::acos(clampUnit(R_47(2,2)));
+                if (std::fabs(std::sin(q(5))) < 1e-9)
+                {
+                    // wrist singularity, joints 5 and 7 aligned: keep joint 5 at zero
+                    if (gc6 < 0) continue;
+                    q(4) = 0.0;
+                    q(6) = R_47(2,2) > 0 ? std::atan2(R_47(1,0), R_47(0,0)) : std::atan2(R_47(1,0), -R_47(0,0));
+                }
+                else
+                {
+                    q(4) = std::atan2(gc6*R_47(1,2), gc6*R_47(0,2));
+                    q(6) = std::atan2(gc6*R_47(2,1), -gc6*R_47(2,0));
+                }
+
+                Vector7 q_chain = sign_.cwiseProduct(q);
+                if ((q_chain.array() >= q_min_.array()).all() && (q_chain.array() <= q_max_.array()).all())
+                {
+                    _sols.col(n_sols++) = q_chain;
+                }
+            }
+        }
+    }
+    return n_sols;
+}
+
+bool KDLAnalyticIK::solveNearest(const KDL::Frame &_F, const Vector7 &_q_near, Vector7 &_q_out)
+{
+    Solutions sols;
+    int n_sols = solve(_F, getArmAngle(_q_near), sols);
+    if (n_sols == 0)
+    {
+        return false;
+    }
+    int best = 0;
+    double best_dist = (sols.col(0) - _q_near).squaredNorm();
+    for (int k = 1; k < n_sols; k++)
+    {
+        double dist = (sols.col(k) - _q_near).squaredNorm();
+        if (dist < best_dist)
+        {
+            best_dist = dist;
+            best = k;
+        }
+    }
+    _q_out = sols.col(best);
+    return true;
+}
+
+double KDLAnalyticIK::getArmAngle(const Vector7 &_q)
+{
+    Vector7 q = sign_.cwiseProduct(_q);
+
+    // actual and reference elbow positions, relative to the shoulder
+    KDL::Frame F = dhFk(q);
+    Eigen::Matrix3d R = toEigen(F.M);
+    Eigen::Vector3d x_sw = toEigen(F.p) - d_wf_*R.col(2) - Eigen::Vector3d(0, 0, d_bs_);
+    Eigen::Vector3d x_se = d_se_*shoulderRotation(q(0), q(1), q(2)).col(1);
+    double q1_ref, q2_ref;
+    referencePlane(x_sw, q(3), q1_ref, q2_ref);
+    Eigen::Vector3d x_se_ref = d_se_*shoulderRotation(q1_ref, q2_ref, 0.0).col(1);
+
+    // signed angle between their components normal to the shoulder-wrist axis
+    Eigen::Vector3d u = x_sw.normalized();
+    Eigen::Vector3d e = x_se - u.dot(x_se)*u;
+    Eigen::Vector3d e_ref = x_se_ref - u.dot(x_se_ref)*u;
+    return std::atan2(u.dot(e_ref.cross(e)), e_ref.dot(e));
+}
+
+KDL::Frame KDLAnalyticIK::dhFk(const Vector7 &_q_dh)
+{
+    static const int D[7] = {0, -1, 1, -1, 2, -1, 3};   // index into the link lengths, -1 for none
+    double d[4] = {d_bs_, d_se_, d_ew_, d_wf_};
+    KDL::Frame T = KDL::Frame::Identity();
+    for (int i = 0; i < 7; i++)
+    {
+        T = T*KDL::Frame(KDL::Rotation::RotZ(_q_dh(i)), KDL::Vector(0, 0, D[i] < 0 ? 0.0 : d[D[i]]))
+             *KDL::Frame(KDL::Rotation::RotX(ALPHA[i]));
+    }
+    return T;
+}
+
+KDL::Frame KDLAnalyticIK::chainFk(const Vector7 &_q)
+{
+    KDL::Frame T = KDL::Frame::Identity();
+    unsigned int j = 0;
+    for (unsigned int k = 0; k < chain_.getNrOfSegments(); k++)
+    {
+        const KDL::Segment &seg = chain_.getSegment(k);
+        if (seg.getJoint().getType() != KDL::Joint::None)
+        {
+            T = T*seg.pose(_q(j++));
+        }
+        else
+        {
+            T = T*seg.pose(0.0);
+        }
+    }
+    return T;
+}
+
+// R_03 of the DH model, the shoulder-elbow direction is its second column
+Eigen::Matrix3d KDLAnalyticIK::shoulderRotation(double _q1, double _q2, double _q3)
+{
+    double c1 = std::cos(_q1), s1 = std::sin(_q1);
+    double c2 = std::cos(_q2), s2 = std::sin(_q2);
+    double c3 = std::cos(_q3), s3 = std::sin(_q3);
+    Eigen::Matrix3d R_03;
+    R_03 << c1*c2*c3 - s1*s3, c1*s2, c1*c2*s3 + s1*c3,
+            s1*c2*c3 + c1*s3, s1*s2, s1*c2*s3 - c1*c3,
+            -s2*c3,           c2,    -s2*s3;
+    return R_03;
+}
+
+// joints 1 and 2 that place the wrist on x_sw with joint 3 at zero
+void KDLAnalyticIK::referencePlane(const Eigen::Vector3d &_x_sw, double _q4, double &_q1, double &_q2)
+{
+    double r = std::sqrt(_x_sw(0)*_x_sw(0) + _x_sw(1)*_x_sw(1));
+    _q1 = r > 1e-9 ? std::atan2(_x_sw(1), _x_sw(0)) : 0.0;
+    _q2 = std::atan2(r, _x_sw(2)) - std::atan2(-d_ew_*std::sin(_q4), d_se_ + d_ew_*std::cos(_q4));
+}
+
+KDLNumericIK::KDLNumericIK(const KDL::Chain &_chain, const KDL::JntArray &_q_min, const KDL::JntArray &_q_max)
+{
+    n_ = _chain.getNrOfJoints();
+    fkSol_.reset(new KDL::ChainFkSolverPos_recursive(_chain));
+    jacSol_.reset(new KDL::ChainJntToJacSolver(_chain));
+    q_min_ = _q_min;
+    q_max_ = _q_max;
+    eps_ = 1e-5;
+    max_iter_ = 100;
+    lambda_ = 0.01;
+    warm_ = false;
+    q_warm_ = KDL::JntArray(n_);
+    q_ = KDL::JntArray(n_);
+    q_try_ = KDL::JntArray(n_);
+    J_ = KDL::Jacobian(n_);
+    dq_.resize(n_);
+}
+
+void KDLNumericIK::setParams(double _eps, unsigned int _max_iter, double _lambda)
+{
+    eps_ = _eps;
+    max_iter_ = _max_iter;
+    lambda_ = _lambda;
+}
+
+void KDLNumericIK::getParams(double &_eps, unsigned int &_max_iter, double &_lambda)
+{
+    _eps = eps_;
+    _max_iter = max_iter_;
+    _lambda = lambda_;
+}
+
+void KDLNumericIK::resetWarmStart()
+{
+    warm_ = false;
+}
+
+KDLNumericIK::Result KDLNumericIK::solve(const KDL::JntArray &_q_seed, const KDL::Frame &_F,
+                                         double _budget_us, KDL::JntArray &_q_out)
+{
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() +
+            std::chrono::nanoseconds((long long)(_budget_us*1e3));
+
+    // start from the seed or from the previous solution, whichever is closer to the target
+    q_.data = _q_seed.data;
+    clampJnts(q_);
+    double err = poseError(q_, _F);
+    if (warm_)
+    {
+        double err_warm = poseError(q_warm_, _F);
+        if (err_warm < err)
+        {
+            q_.data = q_warm_.data;
+            err = err_warm;
+        }
+    }
+
+    Result res;
+    res.status = MAX_ITER;
+    res.iterations = 0;
+    double lambda = lambda_;
+    while (true)
+    {
+        if (err < eps_)
+        {
+            res.status = CONVERGED;
+            break;
+        }
+        if (res.iterations >= max_iter_)
+        {
+            res.status = MAX_ITER;
+            break;
+        }
+        // the first step is always taken, so an expired budget still improves on the seed
+        if (_budget_us > 0 && res.iterations > 0 && std::chrono::steady_clock::now() >= deadline)
+        {
+            res.status = DEADLINE;
+            break;
+        }
+        res.iterations++;
+
+        // damped least-squares step dq = J^T (J J^T + lambda^2 I)^-1 e
+        poseError(q_, _F);
+        jacSol_->JntToJac(q_, J_);
+        A_.noalias() = J_.data*J_.data.transpose();
+        A_.diagonal().array() += lambda*lambda;
+        e_ = A_.ldlt().solve(e_);
+        dq_.noalias() = J_.data.transpose()*e_;
+
+        // backtracking line search on the pose error
+        bool improved = false;
+        double alpha = 1.0;
+        for (int ls = 0; ls < 5; ls++)
+        {
+            q_try_.data = q_.data + alpha*dq_;
+            clampJnts(q_try_);
+            double err_try = poseError(q_try_, _F);
+            if (err_try < err)
+            {
+                q_.data = q_try_.data;
+                err = err_try;
+                improved = true;
+                break;
+            }
+            alpha *= 0.5;
+        }
+
+        // more damping near singularities or limits, less when the step is accepted
+        lambda = improved ? std::max(0.5*lambda, lambda_) : std::min(4.0*lambda, 1.0);
+    }
+
+    res.error = err;
+    _q_out.data = q_.data;
+    // an iterate stuck at the iteration limit would trap the next call, do not warm start from it
+    q_warm_.data = q_.data;
+    warm_ = res.status != MAX_ITER;
+    return res;
+}
+
+// pose error norm, leaves the error twist in e_
+double KDLNumericIK::poseError(const KDL::JntArray &_q, const KDL::Frame &_F)
+{
+    fkSol_->JntToCart(_q, F_);
+    e_ = toEigen(KDL::diff(F_, _F));
+    return e_.norm();
+}
+
+void KDLNumericIK::clampJnts(KDL::JntArray &_q)
+{
+    _q.data = _q.data.cwiseMax(q_min_.data).cwiseMin(q_max_.data);
+}
@@ -1,9 +1,11 @@
 #include "kdl_ros_control/kdl_planner.h"
+#include "kdl_ros_control/utils.h"
 #include <cmath>
+#include <stdio.h>
 
 KDLPlanner::KDLPlanner(double _maxVel, double _maxAcc)
 {
-    velpref_ = new KDL::VelocityProfile_Trap(_maxVel,_maxAcc);
+    velpref_.reset(new KDL::VelocityProfile_Trap(_maxVel,_maxAcc));
 }
 
 KDLPlanner::KDLPlanner(double _trajDuration, double _accDuration, Eigen::Vector3d _trajInit, Eigen::Vector3d _trajEnd)
@@ -38,7 +40,15 @@ void KDLPlanner::CreateTrajectoryFromFrames(std::vector<KDL::Frame> &_frames,
                                             double _radius, double _eqRadius
                                             )
 {
-    path_ = new KDL::Path_RoundedComposite(_radius,_eqRadius,new KDL::RotationalInterpolation_SingleAxis());
+    if (!velpref_)
+    {
+        printf("KDL trajectories need the velocity profile constructor \n");
+        return;
+    }
+    // release the previous trajectory before its path
+    traject_.reset();
+    path_circle_.reset();
+    path_.reset(new KDL::Path_RoundedComposite(_radius,_eqRadius,new KDL::RotationalInterpolation_SingleAxis()));
 
     for (unsigned int i = 0; i < _frames.size(); i++)
     {
@@ -47,7 +57,7 @@ void KDLPlanner::CreateTrajectoryFromFrames(std::vector<KDL::Frame> &_frames,
     path_->Finish();
 
     velpref_->SetProfile(0,path_->PathLength());
-    traject_ = new KDL::Trajectory_Segment(path_, velpref_);
+    traject_.reset(new KDL::Trajectory_Segment(path_.get(), velpref_.get(), false));
 }
 
 void KDLPlanner::createCircPath(KDL::Frame &_F_start,
@@ -58,122 +68,54 @@ void KDLPlanner::createCircPath(KDL::Frame &_F_start,
                                 double eqradius
                                 )
 {
-    KDL::RotationalInterpolation_SingleAxis* otraj;
-    otraj = new KDL::RotationalInterpolation_SingleAxis();
+    if (!velpref_)
+    {
+        printf("KDL trajectories need the velocity profile constructor \n");
+        return;
+    }
+    traject_.reset();
+    path_.reset();
+    path_circle_.reset();
+
+    std::unique_ptr<KDL::RotationalInterpolation_SingleAxis> otraj(new KDL::RotationalInterpolation_SingleAxis());
     otraj->SetStartEnd(_F_start.M,_R_base_end);
-    path_circle_ = new KDL::Path_Circle(_F_start,
-                                        _V_centre,
-                                        _V_base_p,
-                                        _R_base_end,
-                                        alpha,
-                                        otraj,
-                                        eqradius);
+    path_circle_.reset(new KDL::Path_Circle(_F_start,
+                                            _V_centre,
+                                            _V_base_p,
+                                            _R_base_end,
+                                            alpha,
+                                            otraj.get(),
+                                            eqradius));
+    otraj.release();    // now owned by the path
     velpref_->SetProfile(0,path_circle_->PathLength());
-    traject_ = new KDL::Trajectory_Segment(path_circle_, velpref_);
+    traject_.reset(new KDL::Trajectory_Segment(path_circle_.get(), velpref_.get(), false));
 }
 
 KDL::Trajectory* KDLPlanner::getTrajectory()
 {
-	return traject_;
+	return traject_.get();
 }
 
 void KDLPlanner::trapezoidal_vel(double time, double &s, double &dots,double &ddots)
 {
-  
-  double si=0;
-  double sf=1;
-
-  double ddot_traj_c = -1.0/(std::pow(accDuration_,2)-trajDuration_*accDuration_)*(sf-si);
-
-  if(time <= accDuration_)
-  {
-    s = si + 0.5*ddot_traj_c*std::pow(time,2);
-    dots = ddot_traj_c*time;
-    ddots = ddot_traj_c;
-  }
-  else if(time <= trajDuration_-accDuration_)
-  {
-    s = si + ddot_traj_c*accDuration_*(time-accDuration_/2);
-    dots = ddot_traj_c*accDuration_;
-    ddots = 0;
-  }
-  else
-  {
-    s = sf - 0.5*ddot_traj_c*std::pow(trajDuration_-time,2);
-    dots = ddot_traj_c*(trajDuration_-time);
-    ddots = -ddot_traj_c;
-  }
-
+  TrapezoidalProfile(trajDuration_,accDuration_).eval(time,s,dots,ddots);
 }
 
 void KDLPlanner::cubic_polinomial(double time, double &s, double &dots,double &ddots)
 {
-  
-  double si=0;
-  double sf=1;
-  double dsi=0;
-  double dsf=0;
-  //finding polinomial coefficients
-  double a0=si;
-  double a1=dsi;
-  double a2=3/std::pow(trajDuration_,2);
-  double a3=-2/(std::pow(trajDuration_,3));
-
-  s=a3*std::pow(time,3)+a2*std::pow(time,2)+a1*time+a0;
-  dots=3*a3*std::pow(time,2)+2*a2*time+a1;
-  ddots=6*a3*time+2*a2;
+  CubicProfile(trajDuration_).eval(time,s,dots,ddots);
 }
 
 
 trajectory_point KDLPlanner::path_primitive_linear( double &s, double &dots,double &ddots){ //sono input soltanto, ma evito la copia
   trajectory_point traj;
-  Eigen::Vector3d pi=trajInit_;
-  Eigen::Vector3d pf=trajEnd_;
-  Eigen::Vector3d dif=pf-pi;
-  /*double pnorm=dif.norm();
-  traj.pos=pi+s*dif/pnorm;
-  traj.vel=dots*dif/pnorm;
-  traj.acc=ddots*dif/pnorm;*/
-  traj.pos=(1-s)*pi+s*pf;
-  traj.vel=(-pi+pf)*dots;
-  traj.acc=(-pi+pf)*ddots;
-  //std::cout<<"pos: "<<traj.pos[1]<<" "<<traj.pos[2]<<" "<<traj.pos[3] <<std::endl;
+  LinearPath(trajInit_,trajEnd_).eval(s,dots,ddots,traj);
   return traj;  
 }
 
 trajectory_point KDLPlanner::path_primitive_circular( double &s, double &dots,double &ddots){ //sono input soltanto, ma evito la copia
   trajectory_point traj;
-  Eigen::Vector3d pi = trajInit_;
-  Eigen::Vector3d pf=trajEnd_;
-  Eigen::Vector3d dif=pf-pi;
-
-  
-  // DEFINE  THE CENTER
-  
-  Eigen::Vector3d p0;
-  p0[0] = pi[0]; // centro x
-  p0[1] = pi[1]+trajRadius_; // centro y
-  p0[2] = pi[2]; // centro z
-  
-
-  // POSIZIONE
-  traj.pos[0] = p0[0]; // x
-  traj.pos[1] = p0[1] - trajRadius_*cos(2*M_PI*s); // y
-  traj.pos[2] = p0[2] - trajRadius_*sin(2*M_PI*s); // z
-
-  // VELOCITA
-  traj.vel[0] = 0;
-  traj.vel[1] = trajRadius_*(2*M_PI)*dots*sin(2*M_PI*s);
-  traj.vel[2] = -trajRadius_*(2*M_PI)*dots*cos(2*M_PI*s);
-
-  // ACCELERAZIONE
-  traj.acc[0] = 0;
-  traj.acc[1] = trajRadius_*(2*M_PI)*(dots*dots*2*M_PI*cos(2*M_PI*s)+ddots*sin(2*M_PI*s));
-  traj.acc[2] = -trajRadius_*(2*M_PI)*(-dots*dots*2*M_PI*sin(2*M_PI*s)+ddots*cos(2*M_PI*s));
-
-
-
-  //std::cout<<"pos: "<<traj.pos[1]<<" "<<traj.pos[2]<<" "<<traj.pos[3] <<std::endl;
+  CircularPath(trajInit_,trajRadius_).eval(s,dots,ddots,traj);
   return traj;  
 }
 
@@ -194,7 +136,7 @@ trajectory_point KDLPlanner::compute_cubic_linear( double t){
   double ddst;
   cubic_polinomial(t,st,dst,ddst);
 
-    std::cout<<"time: "<<t<<" s: "<<st<<" s dot: " <<dst<<" s dot dot: "<<ddst<<std::endl;
+    //std::cout<<"time: "<<t<<" s: "<<st<<" s dot: " <<dst<<" s dot dot: "<<ddst<<std::endl;
   //std::cout<<"time: "<<t<<" ";
   return path_primitive_linear(st,dst,ddst);
 }
@@ -205,7 +147,7 @@ trajectory_point KDLPlanner::compute_cubic_circular( double t){
   double ddst;
   cubic_polinomial(t,st,dst,ddst);
 
-    std::cout<<"time: "<<t<<" s: "<<st<<" s dot: " <<dst<<" s dot dot: "<<ddst<<std::endl;
+    //std::cout<<"time: "<<t<<" s: "<<st<<" s dot: " <<dst<<" s dot dot: "<<ddst<<std::endl;
   //std::cout<<"time: "<<t<<" ";
   return path_primitive_circular(st,dst,ddst);
 }
@@ -224,6 +166,12 @@ trajectory_point KDLPlanner::compute_trapezoidal_circular(double time)
 
 trajectory_point KDLPlanner::compute_trajectory(double time,std::string profile, std::string path)
 {
+  // runs in the control loop: report an unknown name once, not at every tick
+  if(!warnedUnknown_ && ((profile!="cubic" && profile!="trapezoidal") || (path!="linear" && path!="circular"))){
+    warnedUnknown_ = true;
+    printf("unknown trajectory %s %s, using %s %s \n", profile.c_str(), path.c_str(),
+           profile=="cubic" ? "cubic" : "trapezoidal", path=="linear" ? "linear" : "circular");
+  }
   if(profile=="cubic"){
     if(path=="linear") return compute_cubic_linear(time);
     else return compute_cubic_circular(time); 
@@ -235,3 +183,208 @@ trajectory_point KDLPlanner::compute_trajectory(double time,std::string profile,
 }
 
 
+
+void KDLPlanner::setOrientation(const Eigen::Matrix3d &_R_init, const Eigen::Matrix3d &_R_end)
+{
+  R_init_ = _R_init;
+  R_end_ = _R_end;
+}
+
+std::unique_ptr<KDLTrajectory> KDLPlanner::createTrajectory(const std::string &profile, const std::string &path)
+{
+  SlerpOrientation orientation(R_init_,R_end_);
+  if(profile=="cubic"){
+    if(path=="linear") return std::unique_ptr<KDLTrajectory>(new ProfiledPath<CubicProfile,LinearPath,SlerpOrientation>(CubicProfile(trajDuration_),LinearPath(trajInit_,trajEnd_),orientation));
+    if(path=="circular") return std::unique_ptr<KDLTrajectory>(new ProfiledPath<CubicProfile,CircularPath,SlerpOrientation>(CubicProfile(trajDuration_),CircularPath(trajInit_,trajRadius_),orientation));
+  }else if(profile=="trapezoidal"){
+    if(path=="linear") return std::unique_ptr<KDLTrajectory>(new ProfiledPath<TrapezoidalProfile,LinearPath,SlerpOrientation>(TrapezoidalProfile(trajDuration_,accDuration_),LinearPath(trajInit_,trajEnd_),orientation));
+    if(path=="circular") return std::unique_ptr<KDLTrajectory>(new ProfiledPath<TrapezoidalProfile,CircularPath,SlerpOrientation>(TrapezoidalProfile(trajDuration_,accDuration_),CircularPath(trajInit_,trajRadius_),orientation));
+  }
+  printf("unknown trajectory %s %s \n", profile.c_str(), path.c_str());
+  return NULL;
+}
+
+std::unique_ptr<KDLTrajectory> KDLPlanner::createSplineTrajectory(const std::vector<KDL::Frame> &_frames, double _avgVel)
+{
+  if(_frames.size() < 2){
+    printf("waypoint trajectory needs at least two frames \n");
+    return NULL;
+  }
+  std::vector<Eigen::Vector3d> points(_frames.size());
+  std::vector<Eigen::Matrix3d> rotations(_frames.size());
+  std::vector<double> times(_frames.size(),0.0);
+  for(unsigned int k = 0; k < _frames.size(); k++){
+    points[k] = toEigen(_frames[k].p);
+    rotations[k] = toEigen(_frames[k].M);
+    if(k > 0) times[k] = times[k-1] + std::max((points[k]-points[k-1]).norm()/_avgVel, 1e-3);
+  }
+  return std::unique_ptr<KDLTrajectory>(new SplineTrajectory(points,times,rotations));
+}
+
+std::unique_ptr<KDLTrajectory> KDLPlanner::createSCurveTrajectory(const std::vector<KDL::Frame> &_frames, double _maxVel,
+                                                                   double _maxAcc, double _maxJerk, double _blend,
+                                                                   double _maxAngVel, double _maxAngAcc, double _maxAngJerk)
+{
+  if(_frames.size() < 2){
+    printf("waypoint trajectory needs at least two frames \n");
+    return NULL;
+  }
+  std::vector<Eigen::Vector3d> points(_frames.size());
+  std::vector<Eigen::Matrix3d> rotations(_frames.size());
+  for(unsigned int k = 0; k < _frames.size(); k++){
+    points[k] = toEigen(_frames[k].p);
+    rotations[k] = toEigen(_frames[k].M);
+  }
+  return std::unique_ptr<KDLTrajectory>(new SCurveTrajectory(points,rotations,_maxVel,_maxAcc,_maxJerk,_maxAngVel,_maxAngAcc,_maxAngJerk,_blend));
+}
+
+bool KDLPlanner::compile(const std::string &profile, const std::string &path, double _dt)
+{
+  // createTrajectory() reports unknown names
+  std::unique_ptr<KDLTrajectory> traj = createTrajectory(profile,path);
+  if(!traj) return false;
+  return compile(*traj,_dt);
+}
+
+bool KDLPlanner::compile(const KDLTrajectory &_traj, double _dt)
+{
+  if(!(_dt > 0.0)){
+    printf("cannot compile a trajectory with sampling time %f \n", _dt);
+    return false;
+  }
+  tableDuration_ = _traj.duration();
+  unsigned int n = std::max(1, (int)std::ceil(tableDuration_/_dt));
+  tableDt_ = tableDuration_/n;
+  tableInvDt_ = 1.0/tableDt_;
+  table_.resize(40,n);
+
+  double h = tableDt_;
+  trajectory_point p0 = _traj.compute(0.0);
+  for (unsigned int k = 0; k < n; k++)
+  {
+    trajectory_point p1 = _traj.compute((k+1)*h);
+    double *c = table_.col(k).data();
+    for (int i = 0; i < 3; i++)
+    {
+      quinticCoeffs(p0.pos[i],p0.vel[i],p0.acc[i],p1.pos[i],p1.vel[i],p1.acc[i],h,c+6*i);
+    }
+
+    // rotation vector from the interval start, rates in the start frame
+    Eigen::Matrix3d Rt = p0.rot.transpose();
+    Eigen::Vector3d phi1 = logRotation(Rt*p1.rot);
+    Eigen::Vector3d w0 = Rt*p0.omega, dw0 = Rt*p0.domega, w1 = Rt*p1.omega, dw1 = Rt*p1.domega;
+    for (int i = 0; i < 3; i++)
+    {
+      quinticCoeffs(0.0,w0[i],dw0[i],phi1[i],w1[i],dw1[i],h,c+18+6*i);
+    }
+    Eigen::Quaterniond q(p0.rot);
+    c[36] = q.w(); c[37] = q.x(); c[38] = q.y(); c[39] = q.z();
+    p0 = p1;
+  }
+  return true;
+}
+
+bool KDLPlanner::isCompiled()
+{
+  return table_.cols() > 0;
+}
+
+void KDLPlanner::sample(double time, trajectory_point &_p)
+{
+  unsigned int n = table_.cols();
+  if (n == 0)
+  {
+    _p = trajectory_point();
+    _p.pos = trajInit_;
+    _p.rot = R_init_;
+    return;
+  }
+  double t = std::min(std::max(time,0.0),tableDuration_);
+  unsigned int k = std::min((unsigned int)(t*tableInvDt_),n-1);
+  double tau = t-k*tableDt_;
+  const double *c = table_.col(k).data();
+  Eigen::Vector3d phi, dphi, ddphi;
+  for (int i = 0; i < 6; i++, c += 6)
+  {
+    double x = c[0]+tau*(c[1]+tau*(c[2]+tau*(c[3]+tau*(c[4]+tau*c[5]))));
+    double v = c[1]+tau*(2*c[2]+tau*(3*c[3]+tau*(4*c[4]+tau*5*c[5])));
+    double a = 2*c[2]+tau*(6*c[3]+tau*(12*c[4]+tau*20*c[5]));
+    if (i < 3) { _p.pos[i] = x; _p.vel[i] = v; _p.acc[i] = a; }
+    else { phi[i-3] = x; dphi[i-3] = v; ddphi[i-3] = a; }
+  }
+
+  // the rotation vector over one interval is small: exp by a normalized quaternion
+  // series, accurate to the fifth order in its angle
+  double a2 = phi.squaredNorm();
+  Eigen::Quaterniond dq(1-a2/8, 0, 0, 0);
+  dq.vec() = (0.5-a2/48)*phi;
+  Eigen::Quaterniond q(c[0],c[1],c[2],c[3]);
+  Eigen::Matrix3d R0 = q.toRotationMatrix();
+  _p.rot = (q*dq).normalized().toRotationMatrix();
+  _p.omega = R0*dphi;
+  _p.domega = R0*ddphi;
+}
+
+trajectory_point KDLPlanner::sample(double time)
+{
+  trajectory_point p;
+  sample(time,p);
+  return p;
+}
+
+void KDLPlanner::setReplanLimits(double _maxVel, double _maxAcc, double _maxAngVel, double _maxAngAcc)
+{
+  replanVel_ = _maxVel;
+  replanAcc_ = _maxAcc;
+  replanAngVel_ = _maxAngVel;
+  replanAngAcc_ = _maxAngAcc;
+}
+
+void KDLPlanner::replan(double _time, const trajectory_point &_current, const KDL::Frame &_goal)
+{
+  Eigen::Vector3d goal_pos = toEigen(_goal.p);
+  Eigen::Matrix3d goal_rot = toEigen(_goal.M);
+  double vel = std::max(replanVel_, _current.vel.norm()), acc = std::max(replanAcc_, _current.acc.norm());
+  double angVel = std::max(replanAngVel_, _current.omega.norm()), angAcc = std::max(replanAngAcc_, _current.domega.norm());
+
+  // rest-to-rest quintic estimate: peak speed 1.875*d/T, peak acceleration 5.77*d/T^2
+  double d = (goal_pos - _current.pos).norm(), ang = logRotation(_current.rot.transpose()*goal_rot).norm();
+  double T = std::max(std::max(1.875*d/vel, std::sqrt(5.77*d/acc)),
+                      std::max(1.875*ang/angVel, std::sqrt(5.77*ang/angAcc)));
+  T = std::max(T, 1e-3);
+
+  // grow until within the limits, then bisect the shortest feasible duration between
+  // the last infeasible one (none if the estimate already is within the limits) and T
+  double v, a, w, dw, tol = 1 + 1e-6;
+  double lo = 0;
+  for (int k = 0; k < 40; k++, T *= 2)
+  {
+    online_ = QuinticTrajectory(_current, goal_pos, goal_rot, T);
+    online_.peaks(32, v, a, w, dw);
+    if (v <= tol*vel && a <= tol*acc && w <= tol*angVel && dw <= tol*angAcc) break;
+    lo = T;
+  }
+  double hi = T;
+  for (int k = 0; k < 8; k++)
+  {
+    double mid = 0.5*(lo + hi);
+    QuinticTrajectory q(_current, goal_pos, goal_rot, mid);
+    q.peaks(32, v, a, w, dw);
+    if (v <= tol*vel && a <= tol*acc && w <= tol*angVel && dw <= tol*angAcc) hi = mid;
+    else lo = mid;
+  }
+  online_ = QuinticTrajectory(_current, goal_pos, goal_rot, hi);
+  onlineStart_ = _time;
+}
+
+void KDLPlanner::sampleOnline(double time, trajectory_point &_p)
+{
+  online_.compute(time - onlineStart_, _p);
+}
+
+trajectory_point KDLPlanner::sampleOnline(double time)
+{
+  trajectory_point p;
+  sampleOnline(time, p);
+  return p;
+}
@@ -0,0 +1,126 @@
+#include "kdl_ros_control/kdl_qp.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+KDLQp::KDLQp()
+    : eps_(1e-5), max_iter_(200), warm_(false), rho_(0.1), sigma_(1e-6), alpha_(1.6)
+{
+    resetStats();
+    x_.setZero();
+}
+
+void KDLQp::setParams(double _eps, unsigned int _max_iter)
+{
+    eps_ = _eps;
+    max_iter_ = _max_iter;
+}
+
+void KDLQp::resetStats()
+{
+    stats_.status = SOLVED;
+    stats_.iterations = 0;
+    stats_.primal_res = 0.0;
+    stats_.dual_res = 0.0;
+    stats_.solve_us = 0.0;
+    stats_.max_solve_us = 0.0;
+    stats_.unsolved = 0;
+}
+
+void KDLQp::resetWarmStart()
+{
+    warm_ = false;
+}
+
+void KDLQp::factorize()
+{
+    MatrixN K = P_;
+    K.diagonal().array() += sigma_;
+    K.noalias() += rho_*A_.transpose()*A_;
+    llt_.compute(K);
+}
+
+KDLQp::Status KDLQp::solve(const MatrixN &_P, const VectorN &_q, const Constraints &_A,
+                           const Bounds &_l, const Bounds &_u, VectorN &_x)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    int m = _A.rows();
+    if (!warm_ || z_.size() != m)
+    {
+        x_.setZero();
+        z_.setZero(m);
+        y_.setZero(m);
+        rho_ = 0.1;
+    }
+    warm_ = true;
+
+    // unit-norm rows
+    P_ = _P;
+    q_ = _q;
+    A_ = _A;
+    l_ = _l;
+    u_ = _u;
+    for (int i = 0; i < m; i++)
+    {
+        double norm = A_.row(i).norm();
+        if (norm < 1e-12) continue;
+        A_.row(i) /= norm;
+        l_(i) /= norm;
+        u_(i) /= norm;
+    }
+    factorize();
+
+    VectorN x_t, rhs, Px;
+    Bounds z_t(m), z_prev(m), Ax(m);
+    VectorN Aty;
+    double r_prim = 0.0, r_dual = 0.0;
+    unsigned int k = 0;
+    stats_.status = MAX_ITER;
+    for (k = 1; k <= max_iter_; k++)
+    {
+        rhs = sigma_*x_ - q_;
+        rhs.noalias() += A_.transpose()*(rho_*z_ - y_);
+        x_t = llt_.solve(rhs);
+        z_t.noalias() = A_*x_t;
+
+        x_ = alpha_*x_t + (1 - alpha_)*x_;
+        z_prev = z_;
+        Ax = alpha_*z_t + (1 - alpha_)*z_prev;
+        z_ = (Ax + y_/rho_).cwiseMax(l_).cwiseMin(u_);
+        y_ += rho_*(Ax - z_);
+
+        if (k % 5 != 0 && k != max_iter_) continue;
+
+        // residuals and stopping test
+        Ax.noalias() = A_*x_;
+        Px.noalias() = P_*x_;
+        Aty.noalias() = A_.transpose()*y_;
+        r_prim = m > 0 ? (Ax - z_).cwiseAbs().maxCoeff() : 0.0;
+        r_dual = (Px + q_ + Aty).cwiseAbs().maxCoeff();
+        double s_prim = m > 0 ? std::max(Ax.cwiseAbs().maxCoeff(), z_.cwiseAbs().maxCoeff()) : 0.0;
+        double s_dual = std::max(std::max(Px.cwiseAbs().maxCoeff(), Aty.cwiseAbs().maxCoeff()),
+                                 q_.cwiseAbs().maxCoeff());
+        if (r_prim <= eps_*(1 + s_prim) && r_dual <= eps_*(1 + s_dual))
+        {
+            stats_.status = SOLVED;
+            break;
+        }
+
+        // rebalance the residuals
+        double ratio = std::sqrt((r_prim/(s_prim + 1e-12))/(r_dual/(s_dual + 1e-12) + 1e-12));
+        if (ratio > 5 || ratio < 0.2)
+        {
+            rho_ = std::min(std::max(rho_*ratio, 1e-6), 1e6);
+            factorize();
+        }
+    }
+    _x = x_;
+
+    stats_.iterations = std::min(k, max_iter_);
+    stats_.primal_res = r_prim;
+    stats_.dual_res = r_dual;
+    stats_.solve_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+    stats_.max_solve_us = std::max(stats_.max_solve_us, stats_.solve_us);
+    if (stats_.status != SOLVED) stats_.unsolved++;
+    return stats_.status;
+}
@@ -20,13 +20,17 @@ KDLRobot::KDLRobot(KDL::Tree &robot_tree)
     b_J_dot_ee_.data.setZero();
     jntArray_ = KDL::JntArray(n_);
     jntVel_ = KDL::JntArray(n_);
+    jntArrayVel_ = KDL::JntArrayVel(n_);
     coriol_ = KDL::JntArray(n_);
+    s_J_f_ = KDL::Jacobian(n_);
+    s_J_dot_f_ = KDL::Jacobian(n_);
     dynParam_ = new KDL::ChainDynParam(chain_,KDL::Vector(0,0,-9.81));
     jacSol_ = new KDL::ChainJntToJacSolver(chain_);
     jntJacDotSol_ = new KDL::ChainJntToJacDotSolver(chain_);
     fkSol_ = new KDL::ChainFkSolverPos_recursive(chain_);
     fkVelSol_ = new KDL::ChainFkSolverVel_recursive(chain_);
     idSolver_ = new KDL::ChainIdSolver_RNE(chain_,KDL::Vector(0,0,-9.81));
+    fusedDyn_.reset(new KDLDynamics(chain_,KDL::Vector(0,0,-9.81)));
     jsim_.resize(n_);
     grav_.resize(n_);
     q_min_.data.resize(n_);
@@ -35,42 +39,193 @@ KDLRobot::KDLRobot(KDL::Tree &robot_tree)
     q_max_.data <<  2.96,2.09,2.96,2.09,2.96, 2.09, 2.96;
     ikVelSol_ = new KDL::ChainIkSolverVel_wdls(chain_);
     ikSol_ = new KDL::ChainIkSolverPos_NR_JL(chain_, q_min_, q_max_, *fkSol_, *ikVelSol_);
+    analyticIk_.reset(new KDLAnalyticIK(chain_, q_min_, q_max_));
+    numericIk_.reset(new KDLNumericIK(chain_, q_min_, q_max_));
+    batchKin_.reset(new KDLBatchKinematics(chain_));
     // jntArray_out_ = KDL::JntArray(n_);
 }
 
-void KDLRobot::update(std::vector<double> _jnt_values, std::vector<double> _jnt_vel)
+void KDLRobot::update(const std::vector<double> &_jnt_values, const std::vector<double> &_jnt_vel)
 {
-    KDL::Twist s_T_f;
-    KDL::Frame s_F_f;
-    KDL::Jacobian s_J_f(7);
-    KDL::Jacobian s_J_dot_f(7);
-    KDL::FrameVel s_Fv_f;
-    KDL::JntArrayVel jntVel(jntArray_,jntVel_);
-    KDL::Twist s_J_dot_q_dot_f;
+    // the maps below read n_ entries, a short vector must not reach them in release builds
+    if (_jnt_values.size() != n_ || _jnt_vel.size() != n_)
+    {
+        std::stringstream ss;
+        ss << "KDL robot has " << n_ << " joints, got " << _jnt_values.size()
+           << " joint values and " << _jnt_vel.size() << " joint velocities";
+        throw std::invalid_argument(ss.str());
+    }
+    update(Eigen::Map<const Eigen::VectorXd>(_jnt_values.data(), n_),
+           Eigen::Map<const Eigen::VectorXd>(_jnt_vel.data(), n_));
+}
 
-    // joints space
+void KDLRobot::update(const Eigen::Ref<const Eigen::VectorXd> &_jnt_values,
+                      const Eigen::Ref<const Eigen::VectorXd> &_jnt_vel)
+{
+    eigen_assert(_jnt_values.size() == n_ && _jnt_vel.size() == n_);
     updateJnts(_jnt_values, _jnt_vel);
-    dynParam_->JntToMass(jntArray_, jsim_);
-    dynParam_->JntToCoriolis(jntArray_, jntVel_, coriol_);
-    dynParam_->JntToGravity(jntArray_, grav_);
+    dirty_ = DIRTY_ALL;
+    fusedBackwardDone_ = false;
+    evalCounters_ = EvalCounters();
+    if (lazy_)
+    {
+        return;
+    }
+
+    // joints space
+    evalJsim();
+    evalCoriolis();
+    evalGravity();
+
+    // robot end-effector
+    evalFk();
+    evalJac();
+    evalJacDot();
+}
+
+void KDLRobot::setLazyEval(bool _lazy)
+{
+    lazy_ = _lazy;
+}
+
+bool KDLRobot::getLazyEval()
+{
+    return lazy_;
+}
+
+const KDLRobot::EvalCounters &KDLRobot::getEvalCounters()
+{
+    return evalCounters_;
+}
+
+void KDLRobot::setFusedDynamics(bool _fused)
+{
+    fused_ = _fused;
+    dirty_ = DIRTY_ALL;
+    fusedBackwardDone_ = false;
+}
+
+bool KDLRobot::getFusedDynamics()
+{
+    return fused_;
+}
+
+void KDLRobot::evalFusedBackward()
+{
+    // the backward recursion needs the forward one and serves M, c and g at once
+    evalFk();
+    if (fusedBackwardDone_) return;
+    fusedDyn_->backward();
+    fusedBackwardDone_ = true;
+}
+
+void KDLRobot::evalJsim()
+{
+    if (!(dirty_ & DIRTY_JSIM)) return;
+    if (fused_)
+    {
+        evalFusedBackward();
+        jsim_.data = fusedDyn_->getJsim();
+    }
+    else
+    {
+        dynParam_->JntToMass(jntArray_, jsim_);
+    }
+    dirty_ &= ~DIRTY_JSIM;
+    evalCounters_.jsim++;
+}
+
+void KDLRobot::evalCoriolis()
+{
+    if (!(dirty_ & DIRTY_CORIOLIS)) return;
+    if (fused_)
+    {
+        evalFusedBackward();
+        coriol_.data = fusedDyn_->getCoriolis();
+    }
+    else
+    {
+        dynParam_->JntToCoriolis(jntArray_, jntVel_, coriol_);
+    }
+    dirty_ &= ~DIRTY_CORIOLIS;
+    evalCounters_.coriolis++;
+}
+
+void KDLRobot::evalGravity()
+{
+    if (!(dirty_ & DIRTY_GRAVITY)) return;
+    if (fused_)
+    {
+        evalFusedBackward();
+        grav_.data = fusedDyn_->getGravity();
+    }
+    else
+    {
+        dynParam_->JntToGravity(jntArray_, grav_);
+    }
+    dirty_ &= ~DIRTY_GRAVITY;
+    evalCounters_.gravity++;
+}
+
+void KDLRobot::evalFk()
+{
+    if (!(dirty_ & DIRTY_FK)) return;
 
     // robot flange
-    fkVelSol_->JntToCart(jntVel, s_Fv_f);
-    s_T_f = s_Fv_f.GetTwist();
-    s_F_f = s_Fv_f.GetFrame();
-    int err = jacSol_->JntToJac(jntArray_, s_J_f);
-    err = jntJacDotSol_->JntToJacDot(jntVel, s_J_dot_q_dot_f);
-    err = jntJacDotSol_->JntToJacDot(jntVel, s_J_dot_f);
+    if (fused_)
+    {
+        // one forward recursion also fills the flange Jacobian and Jacobian dot
+        fusedDyn_->forward(jntArray_, jntVel_);
+        s_Fv_f_ = KDL::FrameVel(fusedDyn_->getFrame(), fusedDyn_->getTwist());
+    }
+    else
+    {
+        fkVelSol_->JntToCart(jntArrayVel_, s_Fv_f_);
+    }
+    KDL::Frame s_F_f = s_Fv_f_.GetFrame();
 
     // robot end-effector
     s_F_ee_ = s_F_f*f_F_ee_;
-    KDL::Vector s_p_f_ee = s_F_ee_.p - s_F_f.p;
-    KDL::changeRefPoint(s_J_f, s_p_f_ee, s_J_ee_);
-    KDL::changeRefPoint(s_J_dot_f, s_p_f_ee, s_J_dot_ee_);
+    s_p_f_ee_ = s_F_ee_.p - s_F_f.p;
+    s_V_ee_ = s_Fv_f_.GetTwist().RefPoint(s_p_f_ee_);
+    dirty_ &= ~DIRTY_FK;
+    evalCounters_.fk++;
+}
+
+void KDLRobot::evalJac()
+{
+    if (!(dirty_ & DIRTY_JAC)) return;
+    evalFk();
+    if (fused_)
+    {
+        s_J_f_.data = fusedDyn_->getJacobian();
+    }
+    else
+    {
+        jacSol_->JntToJac(jntArray_, s_J_f_);
+    }
+    KDL::changeRefPoint(s_J_f_, s_p_f_ee_, s_J_ee_);
     KDL::changeBase(s_J_ee_, s_F_ee_.M.Inverse(), b_J_ee_);
-    KDL::changeBase(s_J_dot_ee_, s_F_ee_.M.Inverse(), b_J_dot_ee_);
-    s_V_ee_ = s_T_f.RefPoint(s_p_f_ee);
+    dirty_ &= ~DIRTY_JAC;
+    evalCounters_.jac++;
+}
 
+void KDLRobot::evalJacDot()
+{
+    if (!(dirty_ & DIRTY_JAC_DOT)) return;
+    evalFk();
+    if (fused_)
+    {
+        s_J_dot_f_.data = fusedDyn_->getJacobianDot();
+    }
+    else
+    {
+        jntJacDotSol_->JntToJacDot(jntArrayVel_, s_J_dot_f_);
+    }
+    KDL::changeRefPoint(s_J_dot_f_, s_p_f_ee_, s_J_dot_ee_);
+    KDL::changeBase(s_J_dot_ee_, s_F_ee_.M.Inverse(), b_J_dot_ee_);
+    dirty_ &= ~DIRTY_JAC_DOT;
+    evalCounters_.jac_dot++;
 }
 
 
@@ -106,14 +261,14 @@ unsigned int KDLRobot::getNrSgmts()
 //                                 JOINTS                                     //
 ////////////////////////////////////////////////////////////////////////////////
 
-void KDLRobot::updateJnts(std::vector<double> _jnt_pos, std::vector<double> _jnt_vel)
+void KDLRobot::updateJnts(const Eigen::Ref<const Eigen::VectorXd> &_jnt_pos,
+                          const Eigen::Ref<const Eigen::VectorXd> &_jnt_vel)
 {
-    for (unsigned int i = 0; i < n_; i++)
-    {
-        //std::cout << _jnt_pos[i] << std::endl;
-        jntArray_(i) = _jnt_pos[i];
-        jntVel_(i) = _jnt_vel[i];
-    }
+    // sizes match, so these are plain copies into the preallocated storage
+    jntArray_.data = _jnt_pos;
+    jntVel_.data = _jnt_vel;
+    jntArrayVel_.q.data = _jnt_pos;
+    jntArrayVel_.qdot.data = _jnt_vel;
 }
 Eigen::VectorXd KDLRobot::getJntValues()
 {
@@ -138,16 +293,19 @@ Eigen::MatrixXd KDLRobot::getJntLimits()
 
 Eigen::MatrixXd KDLRobot::getJsim()
 {
+    evalJsim();
     return jsim_.data;
 }
 
 Eigen::VectorXd KDLRobot::getCoriolis()
 {
+    evalCoriolis();
     return coriol_.data;
 }
 
 Eigen::VectorXd KDLRobot::getGravity()
 {
+    evalGravity();
     return grav_.data;
 }
 
@@ -171,6 +329,15 @@ KDL::JntArray KDLRobot::getInvKin(const KDL::JntArray &q,
 {
     KDL::JntArray jntArray_out_;
     jntArray_out_.resize(chain_.getNrOfJoints());
+    if (analyticIkOn_)
+    {
+        KDLAnalyticIK::Vector7 q_out;
+        if (analyticIk_->solveNearest(eeFrame, q.data, q_out))
+        {
+            jntArray_out_.data = q_out;
+            return jntArray_out_;
+        }
+    }
     int err = ikSol_->CartToJnt(q, eeFrame, jntArray_out_);
     if (err != 0)
     {
@@ -179,6 +346,98 @@ KDL::JntArray KDLRobot::getInvKin(const KDL::JntArray &q,
     return jntArray_out_;
 }
 
+KDL::JntArray KDLRobot::getInvKin(const KDL::JntArray &q,
+                                  const KDL::Frame &eeFrame,
+                                  double _budget_us,
+                                  KDLNumericIK::Result &_result)
+{
+    KDL::JntArray jntArray_out_(chain_.getNrOfJoints());
+    if (analyticIkOn_)
+    {
+        KDLAnalyticIK::Vector7 q_out;
+        if (analyticIk_->solveNearest(eeFrame, q.data, q_out))
+        {
+            jntArray_out_.data = q_out;
+            _result.status = KDLNumericIK::CONVERGED;
+            _result.iterations = 0;
+            _result.error = 0.0;
+            return jntArray_out_;
+        }
+    }
+    _result = numericIk_->solve(q, eeFrame, _budget_us, jntArray_out_);
+    return jntArray_out_;
+}
+
+void KDLRobot::setInvKinParams(double _eps, unsigned int _max_iter, double _lambda)
+{
+    numericIk_->setParams(_eps, _max_iter, _lambda);
+}
+
+void KDLRobot::getFkBatch(const Eigen::MatrixXd &_q, Eigen::MatrixXd &_frames,
+                          Eigen::MatrixXd *_jac, unsigned int _threads)
+{
+    batchKin_->fk(_q, _frames, _jac, _threads);
+}
+
+void KDLRobot::getInvKinBatch(const Eigen::MatrixXd &_q_seed, const Eigen::MatrixXd &_frames, double _budget_us,
+                              Eigen::MatrixXd &_q_out, Eigen::VectorXi &_status, unsigned int _threads)
+{
+    unsigned int n_samples = _frames.rows();
+    _q_out.resize(n_samples, n_);
+    _status.resize(n_samples);
+    KDL::Frame F_ee_inv = f_F_ee_.Inverse();
+    double eps, lambda;
+    unsigned int max_iter;
+    numericIk_->getParams(eps, max_iter, lambda);
+    KDLBatchKinematics::parallelBlocks(n_samples, _threads, [&](unsigned int _k0, unsigned int _len) {
+        // one numeric solver per block, set up as the robot's one; the analytic one is stateless
+        KDLNumericIK numericIk(chain_, q_min_, q_max_);
+        numericIk.setParams(eps, max_iter, lambda);
+        KDL::JntArray q_seed(n_), q_out(n_);
+        for (unsigned int k = _k0; k < _k0 + _len; k++)
+        {
+            KDL::Frame F = KDLBatchKinematics::getFrame(_frames, k)*F_ee_inv;
+            q_seed.data = _q_seed.row(k).transpose();
+            KDLAnalyticIK::Vector7 q_a;
+            if (analyticIkOn_ && analyticIk_->solveNearest(F, q_seed.data, q_a))
+            {
+                _q_out.row(k) = q_a.transpose();
+                _status(k) = KDLNumericIK::CONVERGED;
+                continue;
+            }
+            numericIk.resetWarmStart();
+            KDLNumericIK::Result res = numericIk.solve(q_seed, F, _budget_us, q_out);
+            _q_out.row(k) = q_out.data.transpose();
+            _status(k) = res.status;
+        }
+    });
+}
+
+void KDLRobot::setAnalyticIk(bool _analytic)
+{
+    if (_analytic && !analyticIk_->isValid())
+    {
+        printf("analytic inverse kinematics not available for this chain \n");
+        return;
+    }
+    analyticIkOn_ = _analytic;
+}
+
+bool KDLRobot::getAnalyticIk()
+{
+    return analyticIkOn_;
+}
+
+int KDLRobot::getInvKinAnalytic(const KDL::Frame &eeFrame, double _psi, KDLAnalyticIK::Solutions &_sols)
+{
+    return analyticIk_->solve(eeFrame, _psi, _sols);
+}
+
+double KDLRobot::getArmAngle(const KDL::JntArray &q)
+{
+    return analyticIk_->getArmAngle(q.data);
+}
+
 KDL::JntArray KDLRobot::getInvKinVel(const KDL::JntArray &qd,
                         const KDL::Twist &eeFrameVel)
 {
@@ -210,6 +469,7 @@ KDL::JntArray KDLRobot::getInvKinVel(const KDL::JntArray &qd,
 
 KDL::Frame KDLRobot::getEEFrame()
 {
+    evalFk();
     return s_F_ee_;
 }
 
@@ -222,16 +482,19 @@ KDL::Frame KDLRobot::getFlangeEE()
 
 KDL::Twist KDLRobot::getEEVelocity()
 {
+    evalFk();
     return s_V_ee_;
 }
 
 KDL::Twist KDLRobot::getEEBodyVelocity()
 {
+    evalFk();
     return s_V_ee_;
 }
 
 KDL::Jacobian KDLRobot::getEEJacobian()
 {
+    evalJac();
     return s_J_ee_;
 }
 //////////////
@@ -242,6 +505,7 @@ KDL::Jacobian KDLRobot::getEEJacobian()
 ///////////////////
 KDL::Jacobian KDLRobot::getEEBodyJacobian()
 {
+    evalJac();
     return b_J_ee_;
 }
 
@@ -251,16 +515,21 @@ KDL::Jacobian KDLRobot::getEEBodyJacobian()
 // }
 Eigen::VectorXd KDLRobot::getEEJacDotqDot()
 {
+    evalJacDot();
     return s_J_dot_ee_.data*jntVel_.data;
 }
 
 Eigen::VectorXd KDLRobot::getEEJacDotqDot_red()
 {
+    evalJacDot();
     return s_J_dot_ee_.data.topRows(3)*jntVel_.data;
 }
 
 void KDLRobot::addEE(const KDL::Frame &_f_F_ee)
 {
     f_F_ee_ = _f_F_ee;
-    this->update(toStdVector(this->jntArray_.data), toStdVector(this->jntVel_.data));
+    KDL::Chain chain_ee = chain_;
+    chain_ee.addSegment(KDL::Segment(KDL::Joint(KDL::Joint::None), f_F_ee_));
+    batchKin_.reset(new KDLBatchKinematics(chain_ee));
+    this->update(this->jntArray_.data, this->jntVel_.data);
 }
\ No newline at end of file
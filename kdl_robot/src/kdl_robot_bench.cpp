@@ -0,0 +1,536 @@
+#include "kdl_ros_control/kdl_robot.h"
+#include "kdl_ros_control/kdl_control.h"
+#include "kdl_ros_control/kdl_planner.h"
+
+#include "kdl_parser/kdl_parser.hpp"
+#include "urdf/model.h"
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <random>
+
+// Microbenchmarks of the control loop hot paths on the iiwa14 model, loaded offline.
+// Every benchmark reports ns/op, heap allocations per op and the p99 latency of a
+// single call, cycling over a fixed set of random joint configurations.
+
+#ifndef IIWA14_URDF
+#define IIWA14_URDF "iiwa14.urdf"
+#endif
+
+// Allocation counters: allocations, and blocks currently alive
+static std::atomic<size_t> g_allocs(0);
+static std::atomic<long> g_live(0);
+
+void* operator new(std::size_t size)
+{
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_live.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    if (p) g_live.fetch_sub(1, std::memory_order_relaxed);
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    if (p) g_live.fetch_sub(1, std::memory_order_relaxed);
+    std::free(p);
+}
+
+// Shared fixture
+static const unsigned int N_SAMPLES = 1024;
+static std::string urdf_path = IIWA14_URDF;
+
+struct BenchRobot
+{
+    KDL::Tree tree;
+    KDLRobot* robot;
+    std::vector<Eigen::VectorXd> q, dq;
+    std::vector<KDL::Frame> frames;
+    std::vector<KDL::Twist> twists;
+
+    BenchRobot()
+    {
+        urdf::Model model;
+        if (!model.initFile(urdf_path) || !kdl_parser::treeFromUrdfModel(model, tree))
+        {
+            printf("Failed to load %s \n", urdf_path.c_str());
+            std::exit(1);
+        }
+        robot = new KDLRobot(tree);
+        robot->addEE(KDL::Frame::Identity());
+
+        // random configurations within 90% of the joint limits and their end-effector poses
+        std::mt19937 gen(42);
+        std::uniform_real_distribution<double> unit(-1.0, 1.0);
+        Eigen::MatrixXd lim = robot->getJntLimits();
+        unsigned int n = robot->getNrJnts();
+        for (unsigned int k = 0; k < N_SAMPLES; k++)
+        {
+            Eigen::VectorXd qk(n), dqk(n);
+            for (unsigned int i = 0; i < n; i++)
+            {
+                qk(i) = 0.9*unit(gen)*lim(i,1);
+                dqk(i) = unit(gen);
+            }
+            robot->update(qk, dqk);
+            q.push_back(qk);
+            dq.push_back(dqk);
+            frames.push_back(robot->getEEFrame());
+            twists.push_back(robot->getEEVelocity());
+        }
+    }
+};
+
+static BenchRobot& fixture()
+{
+    static BenchRobot b;
+    return b;
+}
+
+// Times each call of f(k), k cycling over the samples, and fills the counters.
+template <typename F>
+static void runTimed(benchmark::State &state, F f)
+{
+    std::vector<double> samples;
+    samples.reserve(state.max_iterations);
+    size_t allocs = g_allocs.load();
+    unsigned int k = 0;
+    for (auto _ : state)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        f(k);
+        auto t1 = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+        k = (k + 1) % N_SAMPLES;
+    }
+    allocs = g_allocs.load() - allocs;
+
+    if (samples.empty()) return;
+    size_t i99 = samples.size()*99/100;
+    std::nth_element(samples.begin(), samples.begin() + i99, samples.end());
+    state.counters["allocs/op"] = benchmark::Counter(double(allocs)/samples.size());
+    state.counters["p99_ns"] = benchmark::Counter(samples[i99]);
+}
+
+// KDLRobot
+static void BM_RobotUpdate(benchmark::State &state)
+{
+    BenchRobot &b = fixture();
+    b.robot->setFusedDynamics(state.range(0));
+    runTimed(state, [&](unsigned int k) {
+        b.robot->update(b.q[k], b.dq[k]);
+    });
+    b.robot->setFusedDynamics(false);
+}
+BENCHMARK(BM_RobotUpdate)->Arg(0)->Arg(1)->ArgName("fused");
+
+static void BM_RobotUpdateStdVector(benchmark::State &state)
+{
+    BenchRobot &b = fixture();
+    std::vector<std::vector<double>> q, dq;
+    for (unsigned int k = 0; k < N_SAMPLES; k++)
+    {
+        q.push_back(toStdVector(b.q[k]));
+        dq.push_back(toStdVector(b.dq[k]));
+    }
+    runTimed(state, [&](unsigned int k) {
+        b.robot->update(q[k], dq[k]);
+    });
+}
+BENCHMARK(BM_RobotUpdateStdVector);
+
+static void BM_InvKin(benchmark::State &state)
+{
+    BenchRobot &b = fixture();
+    b.robot->setAnalyticIk(state.range(0));
+    unsigned int n = b.robot->getNrJnts();
+    KDL::JntArray seed(n), out(n);
+    runTimed(state, [&](unsigned int k) {
+        // seed from the neighbouring sample, as a control loop seeds from the current state
+        seed.data = b.q[(k + 1) % N_SAMPLES];
+        out = b.robot->getInvKin(seed, b.frames[k]);
+        benchmark::DoNotOptimize(out.data.data());
+    });
+    b.robot->setAnalyticIk(false);
+}
+BENCHMARK(BM_InvKin)->Arg(0)->Arg(1)->ArgName("analytic");
+
+static void BM_InvKinBudget(benchmark::State &state)
+{
+    BenchRobot &b = fixture();
+    unsigned int n = b.robot->getNrJnts();
+    KDL::JntArray seed(n), out(n);
+    KDLNumericIK::Result res;
+    unsigned int converged = 0;
+    runTimed(state, [&](unsigned int k) {
+        seed.data = b.q[(k + 1) % N_SAMPLES];
+        out = b.robot->getInvKin(seed, b.frames[k], state.range(0), res);
+        converged += res.status == KDLNumericIK::CONVERGED;
+        benchmark::DoNotOptimize(out.data.data());
+    });
+    state.counters["converged"] = benchmark::Counter(double(converged)/state.iterations());
+}
+BENCHMARK(BM_InvKinBudget)->Arg(50)->Arg(200)->ArgName("budget_us");
+
+static void BM_InvKinVel(benchmark::State &state)
+{
+    BenchRobot &b = fixture();
+    unsigned int n = b.robot->getNrJnts();
+    KDL::JntArray q(n), out(n);
+    runTimed(state, [&](unsigned int k) {
+        q.data = b.q[k];
+        out = b.robot->getInvKinVel(q, b.twists[k]);
+        benchmark::DoNotOptimize(out.data.data());
+    });
+}
+BENCHMARK(BM_InvKinVel);
+
+// Batch API, one op is the whole fixture; items/s is the per-sample throughput
+static void BM_FkBatch(benchmark::State &state)
+{
+    BenchRobot &b = fixture();
+    unsigned int n = b.robot->getNrJnts();
+    Eigen::MatrixXd q(N_SAMPLES, n), frames, jac;
+    for (unsigned int k = 0; k < N_SAMPLES; k++) q.row(k) = b.q[k].transpose();
+    runTimed(state, [&](unsigned int) {
+        b.robot->getFkBatch(q, frames, &jac, state.range(0));
+        benchmark::DoNotOptimize(jac.data());
+    });
+    state.SetItemsProcessed(state.iterations()*N_SAMPLES);
+}
+BENCHMARK(BM_FkBatch)->Arg(1)->Arg(0)->ArgName("threads")->Unit(benchmark::kMicrosecond);
+
+static void BM_InvKinBatch(benchmark::State &state)
+{
+    BenchRobot &b = fixture();
+    unsigned int n = b.robot->getNrJnts();
+    Eigen::MatrixXd seed(N_SAMPLES, n), frames(N_SAMPLES, 12), q_out;
+    Eigen::VectorXi status;
+    for (unsigned int k = 0; k < N_SAMPLES; k++)
+    {
+        seed.row(k) = b.q[(k + 1) % N_SAMPLES].transpose();
+        KDLBatchKinematics::setFrame(b.frames[k], frames, k);
+    }
+    b.robot->setAnalyticIk(state.range(1));
+    runTimed(state, [&](unsigned int) {
+        b.robot->getInvKinBatch(seed, frames, 0, q_out, status, state.range(0));
+        benchmark::DoNotOptimize(q_out.data());
+    });
+    b.robot->setAnalyticIk(false);
+    state.SetItemsProcessed(state.iterations()*N_SAMPLES);
+}
+BENCHMARK(BM_InvKinBatch)->Args({1, 0})->Args({0, 0})->Args({1, 1})->Args({0, 1})
+    ->ArgNames({"threads", "analytic"})->Unit(benchmark::kMicrosecond);
+
+// KDLController, timed as a full control tick: update() followed by the control law
+static void BM_IdCntrJoint(benchmark::State &state)
+{
+    BenchRobot &b = fixture();
+    KDLController controller(*b.robot);
+    unsigned int n = b.robot->getNrJnts();
+    KDL::JntArray qd(n), dqd(n), ddqd(n);
+    ddqd.data.setZero();
+    runTimed(state, [&](unsigned int k) {
+        b.robot->update(b.q[k], b.dq[k]);
+        qd.data = b.q[(k + 1) % N_SAMPLES];
+        dqd.data = b.dq[(k + 1) % N_SAMPLES];
+        Eigen::VectorXd tau = controller.idCntr(qd, dqd, ddqd, 150, 72);
+        benchmark::DoNotOptimize(tau.data());
+    });
+}
+BENCHMARK(BM_IdCntrJoint);
+
+static void BM_IdCntrCartesian(benchmark::State &state)
+{
+    BenchRobot &b = fixture();
+    KDLController controller(*b.robot);
+    KDL::Twist acc = KDL::Twist::Zero();
+    runTimed(state, [&](unsigned int k) {
+        b.robot->update(b.q[k], b.dq[k]);
+        Eigen::VectorXd tau = controller.idCntr(b.frames[(k + 1) % N_SAMPLES], b.twists[(k + 1) % N_SAMPLES],
+                                                acc, 80, 50, 40, 2*sqrt(50));
+        benchmark::DoNotOptimize(tau.data());
+    });
+}
+BENCHMARK(BM_IdCntrCartesian);
+
+static void BM_IdCntrPosition(benchmark::State &state)
+{
+    BenchRobot &b = fixture();
+    KDLController controller(*b.robot);
+    KDL::Twist acc = KDL::Twist::Zero();
+    runTimed(state, [&](unsigned int k) {
+        b.robot->update(b.q[k], b.dq[k]);
+        Eigen::VectorXd tau = controller.idCntr(b.frames[(k + 1) % N_SAMPLES], b.twists[(k + 1) % N_SAMPLES],
+                                                acc, 80, 40);
+        benchmark::DoNotOptimize(tau.data());
+    });
+}
+BENCHMARK(BM_IdCntrPosition);
+
+static void BM_OsCntr(benchmark::State &state)
+{
+    BenchRobot &b = fixture();
+    KDLController controller(*b.robot);
+    KDL::Twist acc = KDL::Twist::Zero();
+    runTimed(state, [&](unsigned int k) {
+        b.robot->update(b.q[k], b.dq[k]);
+        Eigen::VectorXd tau = controller.osCntr(b.frames[(k + 1) % N_SAMPLES], b.twists[(k + 1) % N_SAMPLES],
+                                                acc, 80, 50, 40, 2*sqrt(50), -5*b.dq[k]);
+        benchmark::DoNotOptimize(tau.data());
+    });
+}
+BENCHMARK(BM_OsCntr);
+
+static void BM_StackCntr(benchmark::State &state)
+{
+    BenchRobot &b = fixture();
+    KDLController controller(*b.robot);
+    KDL::Twist acc = KDL::Twist::Zero();
+    Eigen::VectorXd q_posture = Eigen::VectorXd::Zero(7);
+    // activation 0 keeps the joint-limit task always on
+    double activation = state.range(0) ? 0.0 : 1e12;
+    runTimed(state, [&](unsigned int k) {
+        b.robot->update(b.q[k], b.dq[k]);
+        Eigen::VectorXd tau = controller.stackCntr(b.frames[(k + 1) % N_SAMPLES], b.twists[(k + 1) % N_SAMPLES],
+                                                   acc, 80, 50, 40, 2*sqrt(50), 10, activation, q_posture, 10, 5);
+        benchmark::DoNotOptimize(tau.data());
+    });
+}
+BENCHMARK(BM_StackCntr)->Arg(0)->Arg(1)->ArgName("joint_limits");
+
+// iiwa14 torque and velocity limits, solve time of the last call reported as a counter
+static void BM_QpCntr(benchmark::State &state)
+{
+    BenchRobot &b = fixture();
+    KDLController controller(*b.robot);
+    Eigen::VectorXd tau_max(7), dq_max(7);
+    tau_max << 320, 320, 176, 176, 110, 40, 40;
+    dq_max << 1.48, 1.48, 1.75, 1.31, 2.27, 2.36, 2.36;
+    controller.setQpLimits(tau_max, dq_max, 0.05);
+    if (state.range(0)) controller.addWorkspacePlane(Eigen::Vector3d(0, 0, -1), -0.2);
+    KDL::Twist acc = KDL::Twist::Zero();
+    double iterations = 0, calls = 0;
+    runTimed(state, [&](unsigned int k) {
+        b.robot->update(b.q[k], b.dq[k]);
+        Eigen::VectorXd tau = controller.qpCntr(b.frames[(k + 1) % N_SAMPLES], b.twists[(k + 1) % N_SAMPLES],
+                                                acc, 80, 50, 40, 2*sqrt(50));
+        iterations += controller.getQpStats().iterations;
+        calls += 1;
+        benchmark::DoNotOptimize(tau.data());
+    });
+    state.counters["qp_iter"] = benchmark::Counter(calls > 0 ? iterations/calls : 0.0);
+    state.counters["qp_max_us"] = benchmark::Counter(controller.getQpStats().max_solve_us);
+    state.counters["qp_unsolved"] = benchmark::Counter(calls > 0 ? controller.getQpStats().unsolved/calls : 0.0);
+}
+BENCHMARK(BM_QpCntr)->Arg(0)->Arg(1)->ArgName("plane");
+
+static void BM_CartImpCntr(benchmark::State &state)
+{
+    BenchRobot &b = fixture();
+    KDLController controller(*b.robot);
+    Eigen::Matrix<double,6,1> stiffness, damping = Eigen::Matrix<double,6,1>::Constant(0.7);
+    stiffness << 2000, 2000, 2000, 200, 200, 200;
+    runTimed(state, [&](unsigned int k) {
+        b.robot->update(b.q[k], b.dq[k]);
+        Eigen::VectorXd tau = controller.cartImpCntr(b.frames[(k + 1) % N_SAMPLES], b.twists[(k + 1) % N_SAMPLES],
+                                                     stiffness, damping, 10, 0.7, b.q[(k + 1) % N_SAMPLES]);
+        benchmark::DoNotOptimize(tau.data());
+    });
+}
+BENCHMARK(BM_CartImpCntr);
+
+static void BM_JntImpCntr(benchmark::State &state)
+{
+    BenchRobot &b = fixture();
+    KDLController controller(*b.robot);
+    Eigen::VectorXd stiffness = Eigen::VectorXd::Constant(7, 500), damping = Eigen::VectorXd::Constant(7, 0.7);
+    KDL::JntArray qd(7), dqd(7);
+    runTimed(state, [&](unsigned int k) {
+        b.robot->update(b.q[k], b.dq[k]);
+        qd.data = b.q[(k + 1) % N_SAMPLES];
+        Eigen::VectorXd tau = controller.jntImpCntr(qd, dqd, stiffness, damping);
+        benchmark::DoNotOptimize(tau.data());
+    });
+}
+BENCHMARK(BM_JntImpCntr);
+
+// controller kernels in utils.h: dynamic-size versions against the fixed-size ones
+static void BM_Pseudoinverse(benchmark::State &state)
+{
+    BenchRobot &b = fixture();
+    std::vector< Eigen::Matrix<double,6,7> > J(N_SAMPLES);
+    for (unsigned int k = 0; k < N_SAMPLES; k++)
+    {
+        b.robot->update(b.q[k], b.dq[k]);
+        J[k] = b.robot->getEEJacobian().data;
+    }
+    bool damped = state.range(0);
+    runTimed(state, [&](unsigned int k) {
+        Eigen::Matrix<double,7,6> Jpinv = damped ? dampedPseudoinverse(J[k]) : pseudoinverse(J[k]);
+        benchmark::DoNotOptimize(Jpinv.data());
+    });
+}
+BENCHMARK(BM_Pseudoinverse)->Arg(0)->Arg(1)->ArgName("damped");
+
+static void BM_OrientationError(benchmark::State &state)
+{
+    BenchRobot &b = fixture();
+    bool quat = state.range(0);
+    runTimed(state, [&](unsigned int k) {
+        Eigen::Matrix<double,3,3,Eigen::RowMajor> R_d(b.frames[(k + 1) % N_SAMPLES].M.data);
+        Eigen::Matrix<double,3,3,Eigen::RowMajor> R_e(b.frames[k].M.data);
+        Eigen::Vector3d e_o = quat ? computeOrientationErrorQuat(R_d, R_e) : computeOrientationError(R_d, R_e);
+        benchmark::DoNotOptimize(e_o.data());
+    });
+}
+BENCHMARK(BM_OrientationError)->Arg(0)->Arg(1)->ArgName("quaternion");
+
+static void BM_Orthonormalization(benchmark::State &state)
+{
+    BenchRobot &b = fixture();
+    bool fixed = state.range(0);
+    runTimed(state, [&](unsigned int k) {
+        Eigen::Matrix<double,3,3,Eigen::RowMajor> R(b.frames[k].M.data);
+        if (fixed) R = matrixOrthonormalization(R);
+        else R = matrixOrthonormalization(Eigen::MatrixXd(R));
+        benchmark::DoNotOptimize(R.data());
+    });
+}
+BENCHMARK(BM_Orthonormalization)->Arg(0)->Arg(1)->ArgName("fixed");
+
+// KDLPlanner
+static void BM_ComputeTrajectory(benchmark::State &state)
+{
+    static const char* profiles[] = {"trapezoidal", "cubic"};
+    static const char* paths[] = {"linear", "circular"};
+    std::string profile = profiles[state.range(0)];
+    std::string path = paths[state.range(1)];
+
+    double duration = 5.0;
+    KDLPlanner planner(duration, 0.7, Eigen::Vector3d(0.4, 0.2, 0.6), Eigen::Vector3d(0.4, -0.2, 0.6), 0.08);
+    std::vector<double> t(N_SAMPLES);
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<double> time(0.0, duration);
+    for (unsigned int k = 0; k < N_SAMPLES; k++) t[k] = time(gen);
+
+    runTimed(state, [&](unsigned int k) {
+        trajectory_point p = planner.compute_trajectory(t[k], profile, path);
+        benchmark::DoNotOptimize(p);
+    });
+}
+BENCHMARK(BM_ComputeTrajectory)->Args({0, 0})->Args({0, 1})->Args({1, 0})->Args({1, 1})->ArgNames({"cubic", "circular"});
+
+static void BM_ComputeTrajectoryTyped(benchmark::State &state)
+{
+    static const char* profiles[] = {"trapezoidal", "cubic"};
+    static const char* paths[] = {"linear", "circular"};
+
+    double duration = 5.0;
+    KDLPlanner planner(duration, 0.7, Eigen::Vector3d(0.4, 0.2, 0.6), Eigen::Vector3d(0.4, -0.2, 0.6), 0.08);
+    std::unique_ptr<KDLTrajectory> traj = planner.createTrajectory(profiles[state.range(0)], paths[state.range(1)]);
+    std::vector<double> t(N_SAMPLES);
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<double> time(0.0, duration);
+    for (unsigned int k = 0; k < N_SAMPLES; k++) t[k] = time(gen);
+
+    trajectory_point p;
+    runTimed(state, [&](unsigned int k) {
+        traj->compute(t[k], p);
+        benchmark::DoNotOptimize(p);
+    });
+}
+BENCHMARK(BM_ComputeTrajectoryTyped)->Args({0, 0})->Args({0, 1})->Args({1, 0})->Args({1, 1})->ArgNames({"cubic", "circular"});
+
+static void BM_SampleTrajectory(benchmark::State &state)
+{
+    static const char* profiles[] = {"trapezoidal", "cubic"};
+    static const char* paths[] = {"linear", "circular"};
+
+    double duration = 5.0;
+    KDLPlanner planner(duration, 0.7, Eigen::Vector3d(0.4, 0.2, 0.6), Eigen::Vector3d(0.4, -0.2, 0.6), 0.08);
+    planner.compile(profiles[state.range(0)], paths[state.range(1)], 0.002);
+    std::vector<double> t(N_SAMPLES);
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<double> time(0.0, duration);
+    for (unsigned int k = 0; k < N_SAMPLES; k++) t[k] = time(gen);
+
+    trajectory_point p;
+    runTimed(state, [&](unsigned int k) {
+        planner.sample(t[k], p);
+        benchmark::DoNotOptimize(p);
+    });
+}
+BENCHMARK(BM_SampleTrajectory)->Args({0, 0})->Args({0, 1})->Args({1, 0})->Args({1, 1})->ArgNames({"cubic", "circular"});
+
+static void BM_Replan(benchmark::State &state)
+{
+    double duration = 5.0;
+    KDLPlanner planner(duration, 0.7, Eigen::Vector3d(0.4, 0.2, 0.6), Eigen::Vector3d(0.4, -0.2, 0.6), 0.08);
+    std::unique_ptr<KDLTrajectory> traj = planner.createTrajectory("cubic", "linear");
+    std::vector<trajectory_point> current(N_SAMPLES);
+    std::vector<KDL::Frame> goals(N_SAMPLES);
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<double> time(0.0, duration), offset(-0.2, 0.2), angle(-M_PI, M_PI);
+    for (unsigned int k = 0; k < N_SAMPLES; k++)
+    {
+        current[k] = traj->compute(time(gen));
+        goals[k] = KDL::Frame(KDL::Rotation::RPY(angle(gen), angle(gen), angle(gen)),
+                              KDL::Vector(0.4 + offset(gen), offset(gen), 0.6 + offset(gen)));
+    }
+
+    runTimed(state, [&](unsigned int k) {
+        planner.replan(0.0, current[k], goals[k]);
+    });
+}
+BENCHMARK(BM_Replan);
+
+// repeated planning of KDL trajectories on one planner, which releases the previous ones:
+// live_growth is the number of heap blocks left alive by all the iterations but the first,
+// zero for a flat footprint (see also the planner soak test)
+static void BM_PlanKdlTrajectory(benchmark::State &state)
+{
+    KDLPlanner planner(0.25, 0.5);
+    std::vector<KDL::Frame> frames;
+    frames.push_back(KDL::Frame(KDL::Vector(0.4, 0.2, 0.6)));
+    frames.push_back(KDL::Frame(KDL::Rotation::RotZ(0.5), KDL::Vector(0.4, 0.0, 0.5)));
+    frames.push_back(KDL::Frame(KDL::Rotation::RotZ(1.0), KDL::Vector(0.4, -0.2, 0.6)));
+    KDL::Frame F_start(KDL::Vector(0.4, 0.2, 0.6));
+    KDL::Vector centre(0.4, 0.0, 0.6), base_p(0.4, 0.0, 0.8);
+    KDL::Rotation R_end = KDL::Rotation::RotZ(0.5);
+    bool circle = state.range(0);
+
+    long live = 0;
+    bool first = true;
+    for (auto _ : state)
+    {
+        if (circle) planner.createCircPath(F_start, centre, base_p, R_end, M_PI/2, 0.05);
+        else planner.CreateTrajectoryFromFrames(frames, 0.05, 0.05);
+        benchmark::DoNotOptimize(planner.getTrajectory());
+        if (first) live = g_live.load();
+        first = false;
+    }
+    state.counters["live_growth"] = benchmark::Counter(double(g_live.load() - live));
+}
+BENCHMARK(BM_PlanKdlTrajectory)->Arg(0)->Arg(1)->ArgName("circle");
+
+int main(int argc, char **argv)
+{
+    benchmark::Initialize(&argc, argv);
+    // the first argument left after the benchmark flags overrides the URDF path
+    if (argc > 1)
+    {
+        urdf_path = argv[1];
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
@@ -9,12 +9,15 @@
 #include "ros/ros.h"
 #include "std_msgs/Float64.h"
 #include "sensor_msgs/JointState.h"
+#include "geometry_msgs/Pose.h"
 #include "gazebo_msgs/SetModelConfiguration.h"
 
 
 // Global variables
 std::vector<double> jnt_pos(7,0.0), jnt_vel(7,0.0), obj_pos(6,0.0),  obj_vel(6,0.0);
 bool robot_state_available = false;
+KDL::Frame goal_pose;
+bool goal_available = false;
 
 // Functions
 KDLRobot createRobot(std::string robot_string)
@@ -46,6 +49,13 @@ void jointStateCallback(const sensor_msgs::JointState & msg)
     }
 }
 
+void goalPoseCallback(const geometry_msgs::Pose & msg)
+{
+    goal_pose = KDL::Frame(KDL::Rotation::Quaternion(msg.orientation.x, msg.orientation.y, msg.orientation.z, msg.orientation.w),
+                           KDL::Vector(msg.position.x, msg.position.y, msg.position.z));
+    goal_available = true;
+}
+
 // Main
 int main(int argc, char **argv)
 {
@@ -64,6 +74,8 @@ int main(int argc, char **argv)
 
     // Subscribers
     ros::Subscriber joint_state_sub = n.subscribe("/iiwa/joint_states", 1, jointStateCallback);
+    // new end-effector targets, followed from the current reference without stopping
+    ros::Subscriber goal_pose_sub = n.subscribe("/iiwa/goal_pose", 1, goalPoseCallback);
 
     // Publishers
     
@@ -180,6 +192,7 @@ int main(int argc, char **argv)
 
     // Update robot
     robot.update(jnt_pos, jnt_vel);
+    Eigen::VectorXd q_init = robot.getJntValues();
 
     // Init controller
     KDLController controller_(robot);
@@ -206,7 +219,14 @@ int main(int argc, char **argv)
     // Retrieve the first trajectory point
     std::string profile="cubic";
     std::string path="linear";
-    trajectory_point p = planner.compute_trajectory(t,profile,path);
+    Eigen::Matrix3d init_rotation = toEigen(robot.getEEFrame().M);
+    planner.setOrientation(init_rotation, init_rotation);
+    if (!planner.compile(profile,path,0.002))
+    {
+        printf("Failed to plan the %s %s trajectory \n", profile.c_str(), path.c_str());
+        return 0;
+    }
+    trajectory_point p = planner.sample(t);
 
     // Gains
     double Kp = 150, Kd = 72;
@@ -218,9 +238,9 @@ int main(int argc, char **argv)
     // Init trajectory
     KDL::Frame des_pose = KDL::Frame::Identity(); 
     KDL::Twist des_cart_vel = KDL::Twist::Zero(), des_cart_acc = KDL::Twist::Zero();
-    des_pose.M = robot.getEEFrame().M;
+    bool online = false;
 
-    while ((ros::Time::now()-begin).toSec() < 2*traj_duration + init_time_slot)
+    while (ros::ok() && (online || (ros::Time::now()-begin).toSec() < 2*traj_duration + init_time_slot))
     {
         if (robot_state_available)
         {
@@ -234,23 +254,38 @@ int main(int argc, char **argv)
             // Extract desired pose
             des_cart_vel = KDL::Twist::Zero();
             des_cart_acc = KDL::Twist::Zero();
-            if (t <= init_time_slot) // wait a second
+            if (online)
             {
-                p = planner.compute_trajectory(0.0,profile,path);
+                p = planner.sampleOnline(t);
+            }
+            else if (t <= init_time_slot) // wait a second
+            {
+                p = planner.sample(0.0);
             }
             else if(t > init_time_slot && t <= traj_duration + init_time_slot)
             {
-                p = planner.compute_trajectory(t-init_time_slot,profile,path);
-                des_cart_vel = KDL::Twist(KDL::Vector(p.vel[0], p.vel[1], p.vel[2]),KDL::Vector::Zero());
-                des_cart_acc = KDL::Twist(KDL::Vector(p.acc[0], p.acc[1], p.acc[2]),KDL::Vector::Zero());
+                p = planner.sample(t-init_time_slot);
             }
             else
             {
                 ROS_INFO_STREAM_ONCE("trajectory terminated");
                 break;
             }
+            if (goal_available)
+            {
+                // replan from the current reference, continuous up to the acceleration
+                planner.replan(t, p, goal_pose);
+                goal_available = false;
+                online = true;
+            }
+            if (online || t > init_time_slot)
+            {
+                des_cart_vel = KDL::Twist(toKDL(p.vel),toKDL(p.omega));
+                des_cart_acc = KDL::Twist(toKDL(p.acc),toKDL(p.domega));
+            }
 
-            des_pose.p = KDL::Vector(p.pos[0],p.pos[1],p.pos[2]);
+            des_pose.p = toKDL(p.pos);
+            des_pose.M = toKDL(p.rot);
             
             
             // std::cout << "jacobian: " << std::endl << robot.getEEJacobian().data << std::endl;
@@ -277,6 +312,19 @@ int main(int argc, char **argv)
             // Cartesian space inverse dynamics control
             tau = controller_.idCntr(des_pose, des_cart_vel, des_cart_acc,
                                      Kp, Ko, Kdp, 2*sqrt(Ko));
+            // operational-space control, joint damping in the null space
+            // tau = controller_.osCntr(des_pose, des_cart_vel, des_cart_acc,
+            //                          Kp, Ko, Kdp, 2*sqrt(Ko), -5*robot.getJntVelocities());
+            // task stack: pose, joint limits beyond 1.5 times the centred cost, initial posture
+            // tau = controller_.stackCntr(des_pose, des_cart_vel, des_cart_acc,
+            //                             Kp, Ko, Kdp, 2*sqrt(Ko), 10, 42, q_init, 10, 5);
+            // QP control within the torque and velocity limits (see controller_.setQpLimits)
+            // tau = controller_.qpCntr(des_pose, des_cart_vel, des_cart_acc,
+            //                          Kp, Ko, Kdp, 2*sqrt(Ko));
+            // Cartesian impedance, stiffness [N/m, Nm/rad] along the end-effector axes
+            // Eigen::Matrix<double,6,1> stiffness, damping = Eigen::Matrix<double,6,1>::Constant(0.7);
+            // stiffness << 2000, 2000, 2000, 200, 200, 200;
+            // tau = controller_.cartImpCntr(des_pose, des_cart_vel, stiffness, damping, 10, 0.7, q_init);
             //CArtesian space inverse dynamics controll exploiting redundancy, we do not assign the orientation
            //  tau = controller_.idCntr(des_pose, des_cart_vel, des_cart_acc,
             //                          Kp, Kdp);                          
@@ -0,0 +1,236 @@
+#include "kdl_ros_control/kdl_topp.h"
+#include <algorithm>
+#include <fstream>
+
+void TimeOptimalProfile::eval(double t, double &s, double &ds, double &dds) const
+{
+    if (t_.size() < 2)
+    {
+        s = ds = dds = 0.0;
+        return;
+    }
+    if (t >= t_.back())
+    {
+        s = s_.back();
+        ds = dds = 0.0;
+        return;
+    }
+    t = std::max(t, 0.0);
+    unsigned int i = std::upper_bound(t_.begin(), t_.end(), t) - t_.begin() - 1;
+    double tau = t - t_[i];
+    dds = dds_[i];
+    ds = ds_[i] + dds*tau;
+    s = s_[i] + ds_[i]*tau + 0.5*dds*tau*tau;
+}
+
+bool KDLTopp::loadLimits(const std::string &_file, unsigned int _n, Limits &_lim)
+{
+    std::ifstream in(_file.c_str());
+    if (!in)
+    {
+        printf("cannot open joint limits file %s \n", _file.c_str());
+        return false;
+    }
+    _lim.max_vel = Eigen::VectorXd::Zero(_n);
+    _lim.max_acc = Eigen::VectorXd::Zero(_n);
+    _lim.max_effort = Eigen::VectorXd::Zero(_n);
+
+    // joint_limits: / <joint>: / <key>: <value>, joints identified by order
+    int j = -1;
+    bool has_vel = false, has_acc = false;
+    double vel = 0.0, acc = 0.0;
+    std::string line;
+    while (true)
+    {
+        bool more = (bool)std::getline(in, line);
+        size_t indent = more ? line.find_first_not_of(' ') : 0;
+        bool blank = more && (indent == std::string::npos || line[indent] == '#');
+        if (blank) continue;
+        size_t colon = more ? line.find(':') : std::string::npos;
+
+        // a new joint block, or the end of the file, closes the previous joint
+        if (!more || (indent == 2 && colon == line.size() - 1))
+        {
+            if (j >= 0 && j < (int)_n)
+            {
+                _lim.max_vel(j) = has_vel ? vel : 0.0;
+                _lim.max_acc(j) = has_acc ? acc : 0.0;
+            }
+            if (!more) break;
+            j++;
+            has_vel = has_acc = false;
+            vel = acc = 0.0;
+            continue;
+        }
+        if (j < 0 || colon == std::string::npos) continue;
+
+        std::string key = line.substr(indent, colon - indent);
+        std::string value = line.substr(colon + 1);
+        value.erase(0, value.find_first_not_of(' '));
+        if (key == "has_velocity_limits") has_vel = value == "true";
+        else if (key == "has_acceleration_limits") has_acc = value == "true";
+        else if (key == "max_velocity") vel = atof(value.c_str());
+        else if (key == "max_acceleration") acc = atof(value.c_str());
+    }
+    if (j + 1 != (int)_n)
+    {
+        printf("joint limits file has %d joints, expected %d \n", j + 1, _n);
+        return false;
+    }
+    return true;
+}
+
+KDLTopp::KDLTopp(KDLRobot &_robot, const Limits &_lim, unsigned int _n_grid)
+    : robot_(_robot), lim_(_lim), n_grid_(_n_grid)
+{
+}
+
+bool KDLTopp::compute(const Eigen::MatrixXd &_q_path, TimeOptimalProfile &_profile)
+{
+    if (_q_path.rows() != n_grid_ + 1 || _q_path.cols() != robot_.getNrJnts())
+    {
+        printf("TOPP path has %d x %d entries, expected %d x %d \n", (int)_q_path.rows(), (int)_q_path.cols(),
+               n_grid_ + 1, robot_.getNrJnts());
+        return false;
+    }
+    Eigen::VectorXd q0 = robot_.getJntValues(), dq0 = robot_.getJntVelocities();
+    double h = 1.0/n_grid_;
+
+    std::vector< std::vector<HalfPlane> > c(n_grid_ + 1);
+    for (unsigned int i = 0; i <= n_grid_; i++)
+    {
+        buildConstraints(_q_path, i, c[i]);
+    }
+    robot_.update(q0, dq0);
+
+    // backward pass: x_max[i] is the largest ds^2 at point i from which the end is
+    // reachable at rest, x_{i+1} = x_i + 2*h*u_i
+    std::vector<double> x_max(n_grid_ + 1, 0.0);
+    for (int i = n_grid_ - 1; i >= 0; i--)
+    {
+        std::vector<HalfPlane> ci = c[i];
+        HalfPlane up = {1.0, 2*h, x_max[i + 1]};
+        HalfPlane down = {-1.0, -2*h, 0.0};
+        ci.push_back(up);
+        ci.push_back(down);
+        if (!maxX(ci, x_max[i]))
+        {
+            printf("TOPP infeasible at s = %f \n", i*h);
+            return false;
+        }
+    }
+
+    // forward pass: largest feasible path acceleration that keeps x below x_max
+    _profile.s_.resize(n_grid_ + 1);
+    _profile.t_.resize(n_grid_ + 1);
+    _profile.ds_.resize(n_grid_ + 1);
+    _profile.dds_.assign(n_grid_ + 1, 0.0);
+    double x = 0.0;
+    _profile.s_[0] = 0.0;
+    _profile.t_[0] = 0.0;
+    _profile.ds_[0] = 0.0;
+    for (unsigned int i = 0; i < n_grid_; i++)
+    {
+        double u_lo = -1e9, u_hi = (x_max[i + 1] - x)/(2*h);
+        for (unsigned int k = 0; k < c[i].size(); k++)
+        {
+            const HalfPlane &hp = c[i][k];
+            double r = hp.gamma - hp.alpha*x;
+            if (hp.beta > 1e-12) u_hi = std::min(u_hi, r/hp.beta);
+            else if (hp.beta < -1e-12) u_lo = std::max(u_lo, r/hp.beta);
+        }
+        // the backward pass guarantees u_lo <= u_hi up to round-off
+        double u = std::max(u_hi, u_lo);
+        double x_next = std::max(0.0, x + 2*h*u);
+        u = (x_next - x)/(2*h);
+
+        double sd = std::sqrt(x), sd_next = std::sqrt(x_next);
+        if (sd + sd_next < 1e-12)
+        {
+            printf("TOPP stalled at s = %f \n", i*h);
+            return false;
+        }
+        _profile.s_[i + 1] = (i + 1)*h;
+        _profile.t_[i + 1] = _profile.t_[i] + 2*h/(sd + sd_next);
+        _profile.ds_[i + 1] = sd_next;
+        _profile.dds_[i] = u;
+        x = x_next;
+    }
+    return true;
+}
+
+void KDLTopp::buildConstraints(const Eigen::MatrixXd &_q_path, unsigned int _i, std::vector<HalfPlane> &_c)
+{
+    // path derivatives by finite differences on the grid
+    unsigned int n = robot_.getNrJnts();
+    unsigned int i0 = _i == 0 ? 0 : _i - 1, i1 = _i == n_grid_ ? n_grid_ : _i + 1;
+    double h = 1.0/n_grid_;
+    Eigen::VectorXd q = _q_path.row(_i).transpose();
+    Eigen::VectorXd dq = (_q_path.row(i1) - _q_path.row(i0)).transpose()/((i1 - i0)*h);
+    unsigned int j0 = std::min(std::max(_i, 1u), n_grid_ - 1);
+    Eigen::VectorXd ddq = (_q_path.row(j0 + 1) - 2*_q_path.row(j0) + _q_path.row(j0 - 1)).transpose()/(h*h);
+
+    // tau = M*q'*u + (M*q'' + C(q,q')*q')*x + g
+    robot_.update(q, dq);
+    Eigen::MatrixXd M = robot_.getJsim();
+    Eigen::VectorXd a = M*dq;
+    Eigen::VectorXd b = M*ddq + robot_.getCoriolis();
+    Eigen::VectorXd g = robot_.getGravity();
+
+    _c.clear();
+    for (unsigned int j = 0; j < n; j++)
+    {
+        if (lim_.max_vel.size() > j && lim_.max_vel(j) > 0 && std::fabs(dq(j)) > 1e-9)
+        {
+            HalfPlane v = {dq(j)*dq(j), 0.0, lim_.max_vel(j)*lim_.max_vel(j)};
+            _c.push_back(v);
+        }
+        if (lim_.max_acc.size() > j && lim_.max_acc(j) > 0)
+        {
+            HalfPlane hi = {ddq(j), dq(j), lim_.max_acc(j)};
+            HalfPlane lo = {-ddq(j), -dq(j), lim_.max_acc(j)};
+            _c.push_back(hi);
+            _c.push_back(lo);
+        }
+        if (lim_.max_effort.size() > j && lim_.max_effort(j) > 0)
+        {
+            HalfPlane hi = {b(j), a(j), lim_.max_effort(j) - g(j)};
+            HalfPlane lo = {-b(j), -a(j), lim_.max_effort(j) + g(j)};
+            _c.push_back(hi);
+            _c.push_back(lo);
+        }
+    }
+    // bounding box so that the LP stays bounded
+    HalfPlane box[4] = {{-1.0, 0.0, 0.0}, {1.0, 0.0, 1e8}, {0.0, 1.0, 1e8}, {0.0, -1.0, 1e8}};
+    _c.insert(_c.end(), box, box + 4);
+}
+
+// maximum x over the polygon, by enumeration of its vertices
+bool KDLTopp::maxX(const std::vector<HalfPlane> &_c, double &_x)
+{
+    bool found = false;
+    _x = 0.0;
+    for (unsigned int k = 0; k < _c.size(); k++)
+    {
+        for (unsigned int l = k + 1; l < _c.size(); l++)
+        {
+            double det = _c[k].alpha*_c[l].beta - _c[l].alpha*_c[k].beta;
+            if (std::fabs(det) < 1e-12) continue;
+            double x = (_c[k].gamma*_c[l].beta - _c[l].gamma*_c[k].beta)/det;
+            double u = (_c[k].alpha*_c[l].gamma - _c[l].alpha*_c[k].gamma)/det;
+            if (found && x <= _x) continue;
+            bool feasible = true;
+            for (unsigned int m = 0; m < _c.size() && feasible; m++)
+            {
+                double tol = 1e-9*(1.0 + std::fabs(_c[m].gamma));
+                feasible = _c[m].alpha*x + _c[m].beta*u <= _c[m].gamma + tol;
+            }
+            if (feasible)
+            {
+                _x = std::max(x, 0.0);
+                found = true;
+            }
+        }
+    }
+    return found;
+}
@@ -0,0 +1,357 @@
+#include "kdl_ros_control/kdl_trajectory.h"
+#include <algorithm>
+
+// R = R_init*exp(phi) and its angular velocity and acceleration in the base frame from the
+// rotation vector phi and its derivatives: omega = R_init*J(phi)*dphi with J the left
+// Jacobian of SO(3), J(phi) = I + f1*[phi]x + f2*[phi]x^2
+static void rotationFromVector(const Eigen::Matrix3d &_R_init, const Eigen::Vector3d &phi,
+                               const Eigen::Vector3d &dphi, const Eigen::Vector3d &ddphi, trajectory_point &p)
+{
+    double ang = phi.norm(), f1, f2, df1, df2;
+    if (ang < 1e-4)
+    {
+        f1 = 0.5 - ang*ang/24;
+        f2 = 1.0/6 - ang*ang/120;
+        df1 = -ang/12;
+        df2 = -ang/60;
+    }
+    else
+    {
+        double sn = std::sin(ang), cs = std::cos(ang);
+        f1 = (1 - cs)/(ang*ang);
+        f2 = (ang - sn)/(ang*ang*ang);
+        df1 = (ang*sn - 2*(1 - cs))/(ang*ang*ang);
+        df2 = ((1 - cs)*ang - 3*(ang - sn))/(ang*ang*ang*ang);
+    }
+    double dang = ang < 1e-12 ? 0.0 : phi.dot(dphi)/ang;
+    Eigen::Vector3d u = phi.cross(dphi), uu = phi.cross(ddphi);
+    Eigen::Vector3d w = dphi + f1*u + f2*phi.cross(u);
+    Eigen::Vector3d dw = ddphi + f1*uu + f2*phi.cross(uu)
+                       + dang*(df1*u + df2*phi.cross(u)) + f2*dphi.cross(u);
+    p.rot = _R_init*expRotation(phi);
+    p.omega = _R_init*w;
+    p.domega = _R_init*dw;
+}
+
+SplineTrajectory::SplineTrajectory(const std::vector<Eigen::Vector3d> &_points, const std::vector<double> &_times,
+                                   const std::vector<Eigen::Matrix3d> &_rotations)
+{
+    times_ = _times;
+    interpolate(_points, _times, coeffs_);
+
+    R_init_ = Eigen::Matrix3d::Identity();
+    if (_rotations.size() == _points.size())
+    {
+        // rotation vectors from the first waypoint; the log map is unique up to turns of
+        // 2*pi about its axis, take the one closest to the previous waypoint
+        R_init_ = _rotations[0];
+        std::vector<Eigen::Vector3d> phi(_rotations.size(), Eigen::Vector3d::Zero());
+        for (unsigned int k = 1; k < _rotations.size(); k++)
+        {
+            Eigen::Vector3d phi_k = logRotation(R_init_.transpose()*_rotations[k]);
+            double ang = phi_k.norm();
+            phi[k] = phi_k;
+            if (ang > 1e-12)
+            {
+                Eigen::Vector3d axis = phi_k/ang;
+                for (int turns = -2; turns <= 2; turns++)
+                {
+                    Eigen::Vector3d cand = phi_k + 2*M_PI*turns*axis;
+                    if ((cand - phi[k-1]).norm() < (phi[k] - phi[k-1]).norm()) phi[k] = cand;
+                }
+            }
+        }
+        interpolate(phi, _times, rotCoeffs_);
+    }
+}
+
+void SplineTrajectory::interpolate(const std::vector<Eigen::Vector3d> &_points, const std::vector<double> &_times,
+                                   Cubics &_coeffs)
+{
+    unsigned int m = _points.size() - 1;
+
+    // knot velocities from continuity of the acceleration, v_0 = v_m = 0:
+    // h_k v_{k-1} + 2(h_{k-1} + h_k) v_k + h_{k-1} v_{k+1} = rhs_k, solved by the Thomas algorithm
+    std::vector<Eigen::Vector3d> v(m + 1, Eigen::Vector3d::Zero());
+    if (m > 1)
+    {
+        std::vector<double> diag(m), upper(m);
+        std::vector<Eigen::Vector3d> rhs(m);
+        for (unsigned int k = 1; k < m; k++)
+        {
+            double h0 = _times[k] - _times[k-1], h1 = _times[k+1] - _times[k];
+            double lower = h1;
+            diag[k] = 2*(h0 + h1);
+            upper[k] = h0;
+            rhs[k] = 3*(h0/h1*(_points[k+1] - _points[k]) + h1/h0*(_points[k] - _points[k-1]));
+            if (k > 1)
+            {
+                double w = lower/diag[k-1];
+                diag[k] -= w*upper[k-1];
+                rhs[k] -= w*rhs[k-1];
+            }
+        }
+        v[m-1] = rhs[m-1]/diag[m-1];
+        for (unsigned int k = m - 2; k >= 1; k--)
+        {
+            v[k] = (rhs[k] - upper[k]*v[k+1])/diag[k];
+        }
+    }
+
+    // one cubic per segment
+    _coeffs.resize(m);
+    for (unsigned int k = 0; k < m; k++)
+    {
+        double h = _times[k+1] - _times[k];
+        Eigen::Vector3d dp = _points[k+1] - _points[k];
+        _coeffs[k].col(0) = _points[k];
+        _coeffs[k].col(1) = v[k];
+        _coeffs[k].col(2) = (3*dp/h - 2*v[k] - v[k+1])/h;
+        _coeffs[k].col(3) = (-2*dp/h + v[k] + v[k+1])/(h*h);
+    }
+}
+
+void SplineTrajectory::compute(double t, trajectory_point &p) const
+{
+    t = std::min(std::max(t, times_.front()), times_.back());
+    unsigned int k = std::upper_bound(times_.begin(), times_.end(), t) - times_.begin();
+    k = std::min<unsigned int>(std::max(k, 1u), coeffs_.size()) - 1;
+    double tau = t - times_[k];
+    const Eigen::Matrix<double,3,4> &c = coeffs_[k];
+    p.pos = c.col(0) + tau*(c.col(1) + tau*(c.col(2) + tau*c.col(3)));
+    p.vel = c.col(1) + tau*(2*c.col(2) + tau*3*c.col(3));
+    p.acc = 2*c.col(2) + tau*6*c.col(3);
+
+    if (!rotCoeffs_.empty())
+    {
+        const Eigen::Matrix<double,3,4> &r = rotCoeffs_[k];
+        rotationFromVector(R_init_,
+                           r.col(0) + tau*(r.col(1) + tau*(r.col(2) + tau*r.col(3))),
+                           r.col(1) + tau*(2*r.col(2) + tau*3*r.col(3)),
+                           2*r.col(2) + tau*6*r.col(3), p);
+    }
+}
+
+SCurveProfile::SCurveProfile(double _dist, double _maxVel, double _maxAcc, double _maxJerk)
+{
+    dist_ = _dist;
+    jerk_ = _maxJerk;
+
+    // durations of the jerk phase, of the acceleration phase and of the cruise
+    if (_maxVel*_maxJerk >= _maxAcc*_maxAcc)
+    {
+        Tj_ = _maxAcc/_maxJerk;
+        Ta_ = Tj_ + _maxVel/_maxAcc;
+    }
+    else
+    {
+        Tj_ = std::sqrt(_maxVel/_maxJerk);
+        Ta_ = 2*Tj_;
+    }
+    Tv_ = _dist/_maxVel - Ta_;
+
+    // short moves: the maximum speed is not reached
+    if (Tv_ < 0)
+    {
+        Tv_ = 0;
+        if (_dist >= 2*std::pow(_maxAcc, 3)/(_maxJerk*_maxJerk))
+        {
+            Tj_ = _maxAcc/_maxJerk;
+            Ta_ = Tj_/2 + std::sqrt(Tj_*Tj_/4 + _dist/_maxAcc);
+        }
+        else
+        {
+            Tj_ = std::pow(_dist/(2*_maxJerk), 1.0/3.0);
+            Ta_ = 2*Tj_;
+        }
+    }
+    aLim_ = _maxJerk*Tj_;
+    vLim_ = (Ta_ - Tj_)*aLim_;
+}
+
+// acceleration phase from rest to vLim_ in Ta_
+void SCurveProfile::accPhase(double t, double &s, double &ds, double &dds) const
+{
+    if (t < Tj_)
+    {
+        s = jerk_*t*t*t/6;
+        ds = jerk_*t*t/2;
+        dds = jerk_*t;
+    }
+    else if (t < Ta_ - Tj_)
+    {
+        s = aLim_/6*(3*t*t - 3*Tj_*t + Tj_*Tj_);
+        ds = aLim_*(t - Tj_/2);
+        dds = aLim_;
+    }
+    else
+    {
+        double r = Ta_ - t;
+        s = vLim_*Ta_/2 - vLim_*r + jerk_*r*r*r/6;
+        ds = vLim_ - jerk_*r*r/2;
+        dds = jerk_*r;
+    }
+}
+
+void SCurveProfile::eval(double t, double &s, double &ds, double &dds) const
+{
+    double T = duration();
+    if (dist_ <= 0 || t <= 0)
+    {
+        s = ds = dds = 0;
+    }
+    else if (t < Ta_)
+    {
+        accPhase(t, s, ds, dds);
+    }
+    else if (t < Ta_ + Tv_)
+    {
+        s = vLim_*Ta_/2 + vLim_*(t - Ta_);
+        ds = vLim_;
+        dds = 0;
+    }
+    else if (t < T)
+    {
+        // deceleration mirrors the acceleration
+        accPhase(T - t, s, ds, dds);
+        s = dist_ - s;
+        dds = -dds;
+    }
+    else
+    {
+        s = dist_;
+        ds = dds = 0;
+    }
+    // normalize to the unit abscissa of the path primitives
+    if (dist_ > 0)
+    {
+        s /= dist_;
+        ds /= dist_;
+        dds /= dist_;
+    }
+}
+
+SCurveTrajectory::SCurveTrajectory(const std::vector<Eigen::Vector3d> &_points, double _maxVel, double _maxAcc,
+                                   double _maxJerk, double _blend)
+{
+    init(_points, std::vector<Eigen::Matrix3d>(), _maxVel, _maxAcc, _maxJerk, 1.0, 1.0, 1.0, _blend);
+}
+
+SCurveTrajectory::SCurveTrajectory(const std::vector<Eigen::Vector3d> &_points, const std::vector<Eigen::Matrix3d> &_rotations,
+                                   double _maxVel, double _maxAcc, double _maxJerk,
+                                   double _maxAngVel, double _maxAngAcc, double _maxAngJerk, double _blend)
+{
+    init(_points, _rotations, _maxVel, _maxAcc, _maxJerk, _maxAngVel, _maxAngAcc, _maxAngJerk, _blend);
+}
+
+void SCurveTrajectory::init(const std::vector<Eigen::Vector3d> &_points, const std::vector<Eigen::Matrix3d> &_rotations,
+                            double _maxVel, double _maxAcc, double _maxJerk,
+                            double _maxAngVel, double _maxAngAcc, double _maxAngJerk, double _blend)
+{
+    bool rotate = _rotations.size() == _points.size();
+    init_ = _points.front();
+    R_init_ = rotate ? _rotations.front() : Eigen::Matrix3d::Identity();
+    double t = 0;
+    duration_ = 0;
+    for (unsigned int k = 0; k + 1 < _points.size(); k++)
+    {
+        dif_.push_back(_points[k+1] - _points[k]);
+        SCurveProfile profile(dif_.back().norm(), _maxVel, _maxAcc, _maxJerk);
+        if (rotate)
+        {
+            phi_.push_back(logRotation(_rotations[k].transpose()*_rotations[k+1]));
+            SCurveProfile ang_profile(phi_.back().norm(), _maxAngVel, _maxAngAcc, _maxAngJerk);
+            if (ang_profile.duration() > profile.duration()) profile = ang_profile;
+        }
+        profiles_.push_back(profile);
+        start_.push_back(t);
+        double T = profiles_.back().duration();
+        duration_ = std::max(duration_, t + T);
+        t += (1 - _blend)*T;
+    }
+}
+
+void SCurveTrajectory::compute(double t, trajectory_point &p) const
+{
+    // superposition of the moves, overlapping ones blend the corner
+    p.pos = init_;
+    p.vel.setZero();
+    p.acc.setZero();
+    p.rot = R_init_;
+    p.omega.setZero();
+    p.domega.setZero();
+    for (unsigned int k = 0; k < profiles_.size(); k++)
+    {
+        double s, ds, dds;
+        profiles_[k].eval(t - start_[k], s, ds, dds);
+        p.pos += s*dif_[k];
+        p.vel += ds*dif_[k];
+        p.acc += dds*dif_[k];
+
+        // rotations compose in the frame reached by the previous moves
+        if (!phi_.empty() && s > 0)
+        {
+            Eigen::Vector3d w = p.rot*phi_[k];
+            p.domega += dds*w + ds*p.omega.cross(w);
+            p.omega += ds*w;
+            p.rot = p.rot*expRotation(s*phi_[k]);
+        }
+    }
+}
+
+QuinticTrajectory::QuinticTrajectory()
+    : c_(Eigen::Matrix<double,6,6>::Zero()), R_init_(Eigen::Matrix3d::Identity()), duration_(0.0)
+{
+}
+
+QuinticTrajectory::QuinticTrajectory(const trajectory_point &_start, const Eigen::Vector3d &_goal_pos,
+                                     const Eigen::Matrix3d &_goal_rot, double _duration)
+    : R_init_(_start.rot), duration_(_duration)
+{
+    // rotation vector and its rates in the initial frame
+    Eigen::Vector3d phi = logRotation(_start.rot.transpose()*_goal_rot);
+    Eigen::Vector3d w = _start.rot.transpose()*_start.omega;
+    Eigen::Vector3d dw = _start.rot.transpose()*_start.domega;
+    double c[6];
+    for (int i = 0; i < 3; i++)
+    {
+        quinticCoeffs(_start.pos[i], _start.vel[i], _start.acc[i], _goal_pos[i], 0.0, 0.0, _duration, c);
+        for (int j = 0; j < 6; j++) c_(i,j) = c[j];
+        quinticCoeffs(0.0, w[i], dw[i], phi[i], 0.0, 0.0, _duration, c);
+        for (int j = 0; j < 6; j++) c_(i+3,j) = c[j];
+    }
+}
+
+void QuinticTrajectory::eval(double t, Eigen::Matrix<double,6,1> &x, Eigen::Matrix<double,6,1> &v,
+                             Eigen::Matrix<double,6,1> &a) const
+{
+    t = std::min(std::max(t, 0.0), duration_);
+    x = c_.col(0) + t*(c_.col(1) + t*(c_.col(2) + t*(c_.col(3) + t*(c_.col(4) + t*c_.col(5)))));
+    v = c_.col(1) + t*(2*c_.col(2) + t*(3*c_.col(3) + t*(4*c_.col(4) + t*5*c_.col(5))));
+    a = 2*c_.col(2) + t*(6*c_.col(3) + t*(12*c_.col(4) + t*20*c_.col(5)));
+}
+
+void QuinticTrajectory::compute(double t, trajectory_point &p) const
+{
+    Eigen::Matrix<double,6,1> x, v, a;
+    eval(t, x, v, a);
+    p.pos = x.head<3>();
+    p.vel = v.head<3>();
+    p.acc = a.head<3>();
+
+    rotationFromVector(R_init_, x.tail<3>(), v.tail<3>(), a.tail<3>(), p);
+}
+
+void QuinticTrajectory::peaks(unsigned int _n, double &_vel, double &_acc, double &_angVel, double &_angAcc) const
+{
+    _vel = _acc = _angVel = _angAcc = 0.0;
+    trajectory_point p;
+    for (unsigned int k = 0; k <= _n; k++)
+    {
+        compute(k*duration_/_n, p);
+        _vel = std::max(_vel, p.vel.norm());
+        _acc = std::max(_acc, p.acc.norm());
+        _angVel = std::max(_angVel, p.omega.norm());
+        _angAcc = std::max(_angAcc, p.domega.norm());
+    }
+}
@@ -0,0 +1,127 @@
+#include "kdl_ros_control/kdl_robot.h"
+
+#include "kdl_parser/kdl_parser.hpp"
+#include "urdf/model.h"
+#include <gtest/gtest.h>
+
+#include <random>
+
+// The structure-of-arrays recursion of KDLBatchKinematics against KDLRobot::update()
+// sample by sample, on a sample count that leaves a partial last block, serial and
+// on all cores.
+
+#ifndef IIWA14_URDF
+#define IIWA14_URDF "iiwa14.urdf"
+#endif
+
+static const double TOL = 1e-10;
+
+class BatchTest : public ::testing::TestWithParam<unsigned int>
+{
+protected:
+    void SetUp()
+    {
+        urdf::Model model;
+        ASSERT_TRUE(model.initFile(IIWA14_URDF));
+        ASSERT_TRUE(kdl_parser::treeFromUrdfModel(model, tree_));
+        robot_.reset(new KDLRobot(tree_));
+        // an end-effector offset, so that the batch chain differs from the flange one
+        robot_->addEE(KDL::Frame(KDL::Rotation::RPY(0.3, -0.2, 0.5), KDL::Vector(0.02, -0.01, 0.1)));
+        n_ = robot_->getNrJnts();
+
+        std::mt19937 gen(21);
+        std::uniform_real_distribution<double> unit(-1.0, 1.0);
+        Eigen::MatrixXd lim = robot_->getJntLimits();
+        q_.resize(3*KDLBatchKinematics::BLOCK + 5, n_);
+        for (unsigned int k = 0; k < q_.rows(); k++)
+        {
+            for (unsigned int i = 0; i < n_; i++)
+            {
+                q_(k,i) = 0.9*unit(gen)*lim(i,1);
+            }
+        }
+    }
+
+    KDL::Tree tree_;
+    std::unique_ptr<KDLRobot> robot_;
+    unsigned int n_;
+    Eigen::MatrixXd q_;
+};
+
+TEST_P(BatchTest, FkMatchesUpdate)
+{
+    Eigen::MatrixXd frames, jac;
+    robot_->getFkBatch(q_, frames, &jac, GetParam());
+    ASSERT_EQ(q_.rows(), frames.rows());
+    ASSERT_EQ(12, frames.cols());
+    ASSERT_EQ(q_.rows(), jac.rows());
+    ASSERT_EQ(6*n_, jac.cols());
+
+    Eigen::VectorXd dq = Eigen::VectorXd::Zero(n_);
+    for (unsigned int k = 0; k < q_.rows(); k++)
+    {
+        robot_->update(Eigen::VectorXd(q_.row(k).transpose()), dq);
+        EXPECT_TRUE(KDL::Equal(robot_->getEEFrame(), KDLBatchKinematics::getFrame(frames, k), TOL))
+            << "sample " << k;
+        KDL::Jacobian J = robot_->getEEJacobian();
+        for (unsigned int i = 0; i < n_; i++)
+        {
+            for (unsigned int r = 0; r < 6; r++)
+            {
+                EXPECT_NEAR(J.data(r,i), jac(k, 6*i + r), TOL) << "sample " << k << " J(" << r << "," << i << ")";
+            }
+        }
+    }
+
+    // the frames alone are the same
+    Eigen::MatrixXd frames_only;
+    robot_->getFkBatch(q_, frames_only, NULL, GetParam());
+    EXPECT_EQ(0.0, (frames_only - frames).cwiseAbs().maxCoeff());
+}
+
+TEST_P(BatchTest, InvKinReachesTheEndEffectorFrames)
+{
+    Eigen::MatrixXd frames;
+    robot_->getFkBatch(q_, frames, NULL, GetParam());
+    std::mt19937 gen(22);
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+    Eigen::MatrixXd seed = q_;
+    for (unsigned int k = 0; k < seed.rows(); k++)
+    {
+        for (unsigned int i = 0; i < n_; i++)
+        {
+            seed(k,i) += 0.05*unit(gen);
+        }
+    }
+
+    Eigen::MatrixXd q_out, frames_out;
+    Eigen::VectorXi status;
+    robot_->getInvKinBatch(seed, frames, 0.0, q_out, status, GetParam());
+    ASSERT_EQ(q_.rows(), q_out.rows());
+    robot_->getFkBatch(q_out, frames_out, NULL, GetParam());
+    for (unsigned int k = 0; k < q_.rows(); k++)
+    {
+        if (status(k) != KDLNumericIK::CONVERGED) continue;
+        EXPECT_TRUE(KDL::Equal(KDLBatchKinematics::getFrame(frames, k), KDLBatchKinematics::getFrame(frames_out, k),
+                               1e-4)) << "sample " << k;
+    }
+    EXPECT_GT((status.array() == KDLNumericIK::CONVERGED).count(), 0.9*q_.rows());
+
+    // the parameters of the robot's solver apply to every block
+    robot_->setInvKinParams(1e-5, 1, 0.01);
+    robot_->getInvKinBatch(seed, frames, 0.0, q_out, status, GetParam());
+    for (unsigned int k = 0; k < q_.rows(); k++)
+    {
+        EXPECT_NE(KDLNumericIK::DEADLINE, status(k));
+    }
+    EXPECT_GT((status.array() == KDLNumericIK::MAX_ITER).count(), 0.9*q_.rows());
+}
+
+// one thread, all cores
+INSTANTIATE_TEST_CASE_P(Threads, BatchTest, ::testing::Values(1u, 0u));
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
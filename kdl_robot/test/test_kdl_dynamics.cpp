@@ -0,0 +1,128 @@
+#include "kdl_ros_control/kdl_dynamics.h"
+
+#include <kdl/chaindynparam.hpp>
+#include <kdl/chainfksolvervel_recursive.hpp>
+#include <kdl/chainjnttojacdotsolver.hpp>
+#include <kdl/chainjnttojacsolver.hpp>
+#include <kdl/framevel.hpp>
+#include "kdl_parser/kdl_parser.hpp"
+#include "urdf/model.h"
+#include <gtest/gtest.h>
+
+#include <iterator>
+#include <random>
+
+// The fused recursions of KDLDynamics replace the KDL solvers behind the KDLRobot
+// getters: on random states they must reproduce ChainDynParam, ChainJntToJacSolver,
+// ChainJntToJacDotSolver and ChainFkSolverVel_recursive.
+
+#ifndef IIWA14_URDF
+#define IIWA14_URDF "iiwa14.urdf"
+#endif
+
+static const double TOL = 1e-8;
+
+class DynamicsTest : public ::testing::Test
+{
+protected:
+    void SetUp()
+    {
+        urdf::Model model;
+        KDL::Tree tree;
+        ASSERT_TRUE(model.initFile(IIWA14_URDF));
+        ASSERT_TRUE(kdl_parser::treeFromUrdfModel(model, tree));
+        // same chain as KDLRobot::createChain
+        ASSERT_TRUE(tree.getChain(tree.getRootSegment()->first,
+                                  std::prev(std::prev(tree.getSegments().end()))->first, chain_));
+        n_ = chain_.getNrOfJoints();
+        ASSERT_GT(n_, 0u);
+    }
+
+    // random joint state within +-_range, velocities within +-2 rad/s
+    void randomState(std::mt19937 &_gen, double _range, KDL::JntArray &_q, KDL::JntArray &_dq)
+    {
+        std::uniform_real_distribution<double> unit(-1.0, 1.0);
+        _q.resize(n_);
+        _dq.resize(n_);
+        for (unsigned int i = 0; i < n_; i++)
+        {
+            _q(i) = _range*unit(_gen);
+            _dq(i) = 2.0*unit(_gen);
+        }
+    }
+
+    KDL::Chain chain_;
+    unsigned int n_;
+};
+
+TEST_F(DynamicsTest, BackwardMatchesChainDynParam)
+{
+    KDL::Vector grav(0, 0, -9.81);
+    KDLDynamics fused(chain_, grav);
+    KDL::ChainDynParam dynParam(chain_, grav);
+    KDL::JntSpaceInertiaMatrix M(n_);
+    KDL::JntArray q, dq, c(n_), g(n_);
+
+    std::mt19937 gen(1);
+    for (int k = 0; k < 200; k++)
+    {
+        randomState(gen, 3.0, q, dq);
+        fused.forward(q, dq);
+        fused.backward();
+        ASSERT_EQ(0, dynParam.JntToMass(q, M));
+        ASSERT_EQ(0, dynParam.JntToCoriolis(q, dq, c));
+        ASSERT_EQ(0, dynParam.JntToGravity(q, g));
+
+        EXPECT_LT((fused.getJsim() - M.data).cwiseAbs().maxCoeff(), TOL) << "sample " << k;
+        EXPECT_LT((fused.getCoriolis() - c.data).cwiseAbs().maxCoeff(), TOL) << "sample " << k;
+        EXPECT_LT((fused.getGravity() - g.data).cwiseAbs().maxCoeff(), TOL) << "sample " << k;
+    }
+}
+
+TEST_F(DynamicsTest, ForwardMatchesKinematicSolvers)
+{
+    KDLDynamics fused(chain_, KDL::Vector(0, 0, -9.81));
+    KDL::ChainFkSolverVel_recursive fkVelSol(chain_);
+    KDL::ChainJntToJacSolver jacSol(chain_);
+    KDL::ChainJntToJacDotSolver jacDotSol(chain_);
+    KDL::Jacobian J(n_), Jdot(n_);
+    KDL::FrameVel Fv;
+    KDL::JntArray q, dq;
+
+    std::mt19937 gen(2);
+    for (int k = 0; k < 200; k++)
+    {
+        randomState(gen, 3.0, q, dq);
+        KDL::JntArrayVel qdq(q, dq);
+        fused.forward(q, dq);
+        ASSERT_GE(fkVelSol.JntToCart(qdq, Fv), 0);
+        ASSERT_GE(jacSol.JntToJac(q, J), 0);
+        ASSERT_GE(jacDotSol.JntToJacDot(qdq, Jdot), 0);
+
+        EXPECT_TRUE(KDL::Equal(fused.getFrame(), Fv.GetFrame(), TOL)) << "sample " << k;
+        EXPECT_TRUE(KDL::Equal(fused.getTwist(), Fv.GetTwist(), TOL)) << "sample " << k;
+        EXPECT_LT((fused.getJacobian() - J.data).cwiseAbs().maxCoeff(), TOL) << "sample " << k;
+        EXPECT_LT((fused.getJacobianDot() - Jdot.data).cwiseAbs().maxCoeff(), TOL) << "sample " << k;
+        EXPECT_LT((fused.getJacDotqDot() - Jdot.data*dq.data).cwiseAbs().maxCoeff(), TOL) << "sample " << k;
+    }
+}
+
+TEST_F(DynamicsTest, GravityFollowsTheGravityVector)
+{
+    // zero gravity leaves only C*qdot, and no torque at rest
+    KDLDynamics fused(chain_, KDL::Vector::Zero());
+    KDL::JntArray q, dq;
+    std::mt19937 gen(3);
+    randomState(gen, 2.0, q, dq);
+    dq.data.setZero();
+    fused.forward(q, dq);
+    fused.backward();
+    EXPECT_LT(fused.getGravity().cwiseAbs().maxCoeff(), TOL);
+    EXPECT_LT(fused.getCoriolis().cwiseAbs().maxCoeff(), TOL);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
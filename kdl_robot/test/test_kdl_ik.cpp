@@ -0,0 +1,239 @@
+#include "kdl_ros_control/kdl_ik.h"
+#include "kdl_ros_control/utils.h"
+
+#include <kdl/chainfksolverpos_recursive.hpp>
+#include "kdl_parser/kdl_parser.hpp"
+#include "urdf/model.h"
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <iterator>
+#include <random>
+
+// KDLAnalyticIK identifies the DH model of the arm from the KDL chain: on random
+// configurations of the iiwa14 every returned branch must reproduce the target
+// through the chain forward kinematics, not only through the DH model.
+// KDLNumericIK is checked for convergence, the time budget, the joint limits and
+// the warm start.
+
+#ifndef IIWA14_URDF
+#define IIWA14_URDF "iiwa14.urdf"
+#endif
+
+static const double TOL = 1e-9;
+
+class IkTest : public ::testing::Test
+{
+protected:
+    void SetUp()
+    {
+        urdf::Model model;
+        KDL::Tree tree;
+        ASSERT_TRUE(model.initFile(IIWA14_URDF));
+        ASSERT_TRUE(kdl_parser::treeFromUrdfModel(model, tree));
+        // same chain and joint limits as KDLRobot
+        ASSERT_TRUE(tree.getChain(tree.getRootSegment()->first,
+                                  std::prev(std::prev(tree.getSegments().end()))->first, chain_));
+        ASSERT_EQ(7u, chain_.getNrOfJoints());
+        q_min_.resize(7);
+        q_max_.resize(7);
+        q_min_.data << -2.96, -2.09, -2.96, -2.09, -2.96, -2.09, -2.96;
+        q_max_.data = -q_min_.data;
+    }
+
+    // random configuration within _scale times the joint limits
+    KDLAnalyticIK::Vector7 randomJnts(std::mt19937 &_gen, double _scale)
+    {
+        std::uniform_real_distribution<double> unit(-1.0, 1.0);
+        KDLAnalyticIK::Vector7 q;
+        for (int i = 0; i < 7; i++)
+        {
+            q(i) = _scale*unit(_gen)*q_max_(i);
+        }
+        return q;
+    }
+
+    // as randomJnts, away from the shoulder, elbow and wrist singularities
+    KDLAnalyticIK::Vector7 regularJnts(std::mt19937 &_gen, double _scale)
+    {
+        KDLAnalyticIK::Vector7 q;
+        do
+        {
+            q = randomJnts(_gen, _scale);
+        }
+        while (std::fabs(q(1)) < 0.3 || std::fabs(q(3)) < 0.3 || std::fabs(q(5)) < 0.3);
+        return q;
+    }
+
+    KDL::Frame fk(const Eigen::VectorXd &_q)
+    {
+        KDL::ChainFkSolverPos_recursive fkSol(chain_);
+        KDL::JntArray q(chain_.getNrOfJoints());
+        q.data = _q;
+        KDL::Frame F;
+        fkSol.JntToCart(q, F);
+        return F;
+    }
+
+    KDL::Chain chain_;
+    KDL::JntArray q_min_, q_max_;
+};
+
+TEST_F(IkTest, AnalyticBranchesReproduceThePose)
+{
+    KDLAnalyticIK ik(chain_, q_min_, q_max_);
+    ASSERT_TRUE(ik.isValid());
+
+    std::mt19937 gen(11);
+    for (int t = 0; t < 200; t++)
+    {
+        KDLAnalyticIK::Vector7 q = randomJnts(gen, 0.95);
+        KDL::Frame F = fk(q);
+
+        KDLAnalyticIK::Solutions sols;
+        int n_sols = ik.solve(F, ik.getArmAngle(q), sols);
+        ASSERT_GT(n_sols, 0) << "q = " << q.transpose();
+
+        double dist_min = 1e9;
+        for (int k = 0; k < n_sols; k++)
+        {
+            KDLAnalyticIK::Vector7 q_k = sols.col(k);
+            EXPECT_TRUE(KDL::Equal(F, fk(q_k), TOL)) << "branch " << k << " of q = " << q.transpose();
+            EXPECT_TRUE((q_k.array() >= q_min_.data.array()).all() && (q_k.array() <= q_max_.data.array()).all())
+                << "branch " << k << " = " << q_k.transpose();
+            dist_min = std::min(dist_min, (q_k - q).cwiseAbs().maxCoeff());
+        }
+        // the configuration the pose came from is one of the branches
+        EXPECT_LT(dist_min, 1e-8) << "q = " << q.transpose();
+    }
+}
+
+TEST_F(IkTest, AnalyticNearestIsTheSeed)
+{
+    KDLAnalyticIK ik(chain_, q_min_, q_max_);
+    ASSERT_TRUE(ik.isValid());
+
+    std::mt19937 gen(12);
+    for (int t = 0; t < 200; t++)
+    {
+        KDLAnalyticIK::Vector7 q = randomJnts(gen, 0.95);
+        KDLAnalyticIK::Vector7 q_out;
+        ASSERT_TRUE(ik.solveNearest(fk(q), q, q_out));
+        EXPECT_LT((q_out - q).cwiseAbs().maxCoeff(), 1e-8) << "q = " << q.transpose();
+    }
+}
+
+TEST_F(IkTest, AnalyticNeedsSevenJoints)
+{
+    // the chain up to the sixth joint
+    KDL::Chain chain6;
+    for (unsigned int k = 0; chain6.getNrOfJoints() < 6; k++)
+    {
+        chain6.addSegment(chain_.getSegment(k));
+    }
+    KDL::JntArray q_min(6), q_max(6);
+    q_min.data = q_min_.data.head(6);
+    q_max.data = q_max_.data.head(6);
+
+    KDLAnalyticIK ik(chain6, q_min, q_max);
+    EXPECT_FALSE(ik.isValid());
+    KDLAnalyticIK::Solutions sols;
+    EXPECT_EQ(0, ik.solve(fk(Eigen::VectorXd::Zero(7)), 0.0, sols));
+}
+
+TEST_F(IkTest, NumericConvergesOnReachablePoses)
+{
+    KDLNumericIK ik(chain_, q_min_, q_max_);
+    std::mt19937 gen(13);
+    KDL::JntArray seed(7), q_out(7);
+    for (int t = 0; t < 100; t++)
+    {
+        KDLAnalyticIK::Vector7 q = regularJnts(gen, 0.9);
+        seed.data = q + 0.3*randomJnts(gen, 1.0).cwiseQuotient(q_max_.data);
+        KDL::Frame F = fk(q);
+
+        ik.resetWarmStart();
+        KDLNumericIK::Result res = ik.solve(seed, F, 0.0, q_out);
+        ASSERT_EQ(KDLNumericIK::CONVERGED, res.status) << "q = " << q.transpose();
+        EXPECT_LT(res.error, 1e-5);
+        EXPECT_TRUE(KDL::Equal(F, fk(q_out.data), 1e-5));
+    }
+}
+
+TEST_F(IkTest, NumericDeadlineReturnsTheBestIterate)
+{
+    KDLNumericIK ik(chain_, q_min_, q_max_);
+    std::mt19937 gen(14);
+    KDL::JntArray seed(7), q_out(7);
+    KDLAnalyticIK::Vector7 q = regularJnts(gen, 0.8);
+    seed.data = q + 0.5*randomJnts(gen, 1.0).cwiseQuotient(q_max_.data);
+    KDL::Frame F = fk(q);
+    KDL::Twist e_seed = KDL::diff(fk(seed.data), F);
+    double err_seed = toEigen(e_seed).norm();
+
+    // a budget that has expired before the first step
+    KDLNumericIK::Result res = ik.solve(seed, F, 1e-3, q_out);
+    EXPECT_EQ(KDLNumericIK::DEADLINE, res.status);
+    EXPECT_GE(res.iterations, 1u);
+    EXPECT_LT(res.error, err_seed);
+    EXPECT_GT((q_out.data - seed.data).norm(), 0.0);
+    // the reported error is the one of the returned configuration
+    EXPECT_NEAR(toEigen(KDL::diff(fk(q_out.data), F)).norm(), res.error, 1e-12);
+}
+
+TEST_F(IkTest, NumericStaysWithinTheLimits)
+{
+    KDLNumericIK ik(chain_, q_min_, q_max_);
+    ik.setParams(1e-5, 50, 0.01);
+    std::mt19937 gen(15);
+    KDL::JntArray seed(7), q_out(7);
+    for (int t = 0; t < 50; t++)
+    {
+        // targets of configurations beyond the limits and out of reach, seeds up to the limits
+        KDLAnalyticIK::Vector7 q = randomJnts(gen, 1.3);
+        KDL::Frame F = fk(q);
+        if (t % 2)
+        {
+            F.p = F.p*3.0;
+        }
+        seed.data = randomJnts(gen, 1.0);
+
+        ik.resetWarmStart();
+        ik.solve(seed, F, 0.0, q_out);
+        EXPECT_TRUE((q_out.data.array() >= q_min_.data.array()).all() &&
+                    (q_out.data.array() <= q_max_.data.array()).all()) << "q_out = " << q_out.data.transpose();
+    }
+}
+
+TEST_F(IkTest, NumericWarmStartSavesIterations)
+{
+    KDLNumericIK ik(chain_, q_min_, q_max_);
+    std::mt19937 gen(16);
+    KDL::JntArray seed(7), q_out(7);
+    unsigned int it_cold = 0, it_warm = 0;
+    for (int t = 0; t < 20; t++)
+    {
+        // two close targets along a path, both solved from the same distant seed
+        KDLAnalyticIK::Vector7 q = regularJnts(gen, 0.8);
+        KDLAnalyticIK::Vector7 dq = 0.02*randomJnts(gen, 1.0).cwiseQuotient(q_max_.data);
+        seed.data = q + 0.4*randomJnts(gen, 1.0).cwiseQuotient(q_max_.data);
+
+        ik.resetWarmStart();
+        ASSERT_EQ(KDLNumericIK::CONVERGED, ik.solve(seed, fk(q), 0.0, q_out).status);
+        KDLNumericIK::Result warm = ik.solve(seed, fk(q + dq), 0.0, q_out);
+        ik.resetWarmStart();
+        KDLNumericIK::Result cold = ik.solve(seed, fk(q + dq), 0.0, q_out);
+
+        EXPECT_EQ(KDLNumericIK::CONVERGED, warm.status);
+        EXPECT_LT(warm.iterations, cold.iterations);
+        it_warm += warm.iterations;
+        it_cold += cold.iterations;
+    }
+    EXPECT_LT(it_warm, it_cold);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,276 @@
+#include "kdl_ros_control/kdl_planner.h"
+#include "kdl_ros_control/utils.h"
+
+#include <gtest/gtest.h>
+
+// KDLPlanner trajectories and precomputed tables, no robot model needed.
+
+static const double TOL = 1e-9;
+
+static KDLPlanner linearPlanner()
+{
+    return KDLPlanner(5.0, 0.7, Eigen::Vector3d(0.5, 0.2, 0.6), Eigen::Vector3d(0.5, -0.2, 0.6), 0.1);
+}
+
+TEST(PlannerTable, UncompiledSampleIsRestAtStart)
+{
+    KDLPlanner planner = linearPlanner();
+    EXPECT_FALSE(planner.isCompiled());
+    trajectory_point p = planner.sample(1.0);
+    EXPECT_LT((p.pos - Eigen::Vector3d(0.5, 0.2, 0.6)).norm(), TOL);
+    EXPECT_EQ(0.0, p.vel.norm());
+    EXPECT_EQ(0.0, p.acc.norm());
+    EXPECT_LT((p.rot - Eigen::Matrix3d::Identity()).norm(), TOL);
+}
+
+TEST(PlannerTable, UnknownNamesAreRejected)
+{
+    KDLPlanner planner = linearPlanner();
+    EXPECT_FALSE(planner.compile("quintic", "linear", 0.002));
+    EXPECT_FALSE(planner.compile("cubic", "spiral", 0.002));
+    EXPECT_FALSE(planner.compile("cubic", "linear", 0.0));
+    EXPECT_FALSE(planner.isCompiled());
+
+    // a failed compile keeps the previous table
+    ASSERT_TRUE(planner.compile("cubic", "linear", 0.002));
+    trajectory_point before = planner.sample(2.0);
+    EXPECT_FALSE(planner.compile("cubic", "spiral", 0.002));
+    EXPECT_TRUE(planner.isCompiled());
+    EXPECT_LT((planner.sample(2.0).pos - before.pos).norm(), TOL);
+}
+
+TEST(PlannerTable, TableMatchesTrajectory)
+{
+    const char* profiles[] = {"cubic", "trapezoidal"};
+    const char* paths[] = {"linear", "circular"};
+    for (int i = 0; i < 2; i++)
+    {
+        for (int j = 0; j < 2; j++)
+        {
+            KDLPlanner planner = linearPlanner();
+            ASSERT_TRUE(planner.compile(profiles[i], paths[j], 0.002));
+            for (double t = 0.0; t <= 5.0; t += 0.0137)
+            {
+                trajectory_point p = planner.sample(t), q = planner.compute_trajectory(t, profiles[i], paths[j]);
+                EXPECT_LT((p.pos - q.pos).norm(), 1e-6) << profiles[i] << " " << paths[j] << " t " << t;
+                EXPECT_LT((p.vel - q.vel).norm(), 1e-4) << profiles[i] << " " << paths[j] << " t " << t;
+            }
+        }
+    }
+}
+
+TEST(SplineTrajectory, OrientationIsC2ThroughWaypoints)
+{
+    std::vector<KDL::Frame> frames;
+    frames.push_back(KDL::Frame(KDL::Rotation::RPY(0.0, 0.0, 0.0), KDL::Vector(0.5, 0.0, 0.5)));
+    frames.push_back(KDL::Frame(KDL::Rotation::RPY(0.6, -0.3, 0.9), KDL::Vector(0.5, 0.2, 0.6)));
+    frames.push_back(KDL::Frame(KDL::Rotation::RPY(-0.4, 0.5, 2.8), KDL::Vector(0.4, 0.3, 0.5)));
+    frames.push_back(KDL::Frame(KDL::Rotation::RPY(0.2, 0.1, -2.9), KDL::Vector(0.3, 0.0, 0.4)));
+    KDLPlanner planner(0.25, 0.5);
+    std::unique_ptr<KDLTrajectory> traj = planner.createSplineTrajectory(frames, 0.1);
+    ASSERT_TRUE(traj != NULL);
+
+    // through the waypoint orientations, at rest only at the ends
+    EXPECT_LT((traj->compute(0.0).rot - toEigen(frames[0].M)).norm(), 1e-9);
+    EXPECT_LT((traj->compute(traj->duration()).rot - toEigen(frames[3].M)).norm(), 1e-9);
+    EXPECT_LT(traj->compute(0.0).omega.norm(), 1e-9);
+    EXPECT_LT(traj->compute(traj->duration()).omega.norm(), 1e-9);
+
+    // omega and domega are the derivatives of rot and omega, and do not jump
+    double dt = 1e-5, t_knot = 0.0;
+    for (unsigned int k = 1; k + 1 < frames.size(); k++)
+    {
+        t_knot += std::max((frames[k].p - frames[k-1].p).Norm()/0.1, 1e-3);
+        trajectory_point p = traj->compute(t_knot), lo = traj->compute(t_knot - dt), hi = traj->compute(t_knot + dt);
+        EXPECT_LT((p.rot - toEigen(frames[k].M)).norm(), 1e-9) << "waypoint " << k;
+        EXPECT_GT(p.omega.norm(), 1e-2) << "waypoint " << k;
+        EXPECT_LT((hi.omega - lo.omega).norm(), 1e-3*p.omega.norm()) << "waypoint " << k;
+        EXPECT_LT((hi.domega - lo.domega).norm(), 1e-3*(1 + p.domega.norm())) << "waypoint " << k;
+    }
+    for (double t = 0.05; t < traj->duration(); t += 0.173)
+    {
+        trajectory_point p = traj->compute(t), lo = traj->compute(t - dt), hi = traj->compute(t + dt);
+        Eigen::Matrix3d dR = (hi.rot - lo.rot)/(2*dt);
+        Eigen::Matrix3d W = dR*p.rot.transpose();
+        Eigen::Vector3d omega(W(2,1), W(0,2), W(1,0));
+        EXPECT_LT((omega - p.omega).norm(), 1e-5*(1 + p.omega.norm())) << "t " << t;
+        EXPECT_LT(((hi.omega - lo.omega)/(2*dt) - p.domega).norm(), 1e-4*(1 + p.domega.norm())) << "t " << t;
+    }
+}
+
+// position, velocity and acceleration are continuous (each the derivative of the previous
+// one) and within _scale times the limits, jerk included
+static void checkSCurve(const KDLTrajectory &_traj, double _maxVel, double _maxAcc, double _maxJerk, double _scale)
+{
+    double dt = 1e-4;
+    double vel_max = 0, acc_max = 0;
+    for (double t = dt; t < _traj.duration() - dt; t += 0.37*dt)
+    {
+        trajectory_point p = _traj.compute(t), lo = _traj.compute(t - dt), hi = _traj.compute(t + dt);
+        EXPECT_LT(((hi.pos - lo.pos)/(2*dt) - p.vel).norm(), 1e-6) << "t " << t;
+        EXPECT_LT(((hi.vel - lo.vel)/(2*dt) - p.acc).norm(), 1e-3) << "t " << t;
+        EXPECT_LE(((hi.acc - lo.acc)/(2*dt)).norm(), _scale*_maxJerk*(1 + 1e-6)) << "t " << t;
+        vel_max = std::max(vel_max, p.vel.norm());
+        acc_max = std::max(acc_max, p.acc.norm());
+    }
+    EXPECT_LE(vel_max, _scale*_maxVel*(1 + 1e-9));
+    EXPECT_LE(acc_max, _scale*_maxAcc*(1 + 1e-9));
+}
+
+TEST(SCurveTrajectory, MovesOfAnyLengthRespectTheLimits)
+{
+    // with these limits the acceleration saturates on moves longer than 2*a^3/J^2 = 0.08
+    // and the speed on moves longer than v*(a/J + v/a) = 0.35
+    const double v = 0.5, a = 1.0, J = 5.0;
+    const double dist[] = {0.6, 0.2, 0.02};
+    KDLPlanner planner(0.25, 0.5);
+    for (int i = 0; i < 3; i++)
+    {
+        std::vector<KDL::Frame> frames;
+        frames.push_back(KDL::Frame(KDL::Vector(0.5, 0.0, 0.5)));
+        frames.push_back(KDL::Frame(KDL::Vector(0.5, 0.0, 0.5) + dist[i]*KDL::Vector(0.6, -0.8, 0.0)));
+        std::unique_ptr<KDLTrajectory> traj = planner.createSCurveTrajectory(frames, v, a, J, 0.0);
+        ASSERT_TRUE(traj != NULL);
+        SCOPED_TRACE(dist[i]);
+
+        // at rest on the waypoints
+        trajectory_point start = traj->compute(0.0), end = traj->compute(traj->duration());
+        EXPECT_LT((start.pos - toEigen(frames[0].p)).norm(), TOL);
+        EXPECT_LT((end.pos - toEigen(frames[1].p)).norm(), TOL);
+        EXPECT_LT(start.vel.norm() + start.acc.norm() + end.vel.norm() + end.acc.norm(), TOL);
+        checkSCurve(*traj, v, a, J, 1.0);
+
+        // peaks at mid-move and at the end of the first jerk phase
+        double T = traj->duration();
+        double vel_peak = traj->compute(0.5*T).vel.norm();
+        double acc_peak = 0;
+        for (double t = 0.0; t < 0.5*T; t += 1e-4) acc_peak = std::max(acc_peak, traj->compute(t).acc.norm());
+        if (i == 0)
+        {
+            EXPECT_NEAR(v, vel_peak, 1e-9);
+            EXPECT_NEAR(a, acc_peak, 1e-9);
+        }
+        else if (i == 1)
+        {
+            // reduced speed at the acceleration limit
+            EXPECT_LT(vel_peak, v - 1e-2);
+            EXPECT_NEAR(a, acc_peak, 1e-9);
+        }
+        else
+        {
+            // jerk phases only: Tj = cbrt(d/(2J)), four of them
+            double Tj = std::cbrt(dist[i]/(2*J));
+            EXPECT_NEAR(4*Tj, T, 1e-12);
+            EXPECT_NEAR(J*Tj*Tj, vel_peak, 1e-9);
+            EXPECT_NEAR(J*Tj, acc_peak, 1e-3*J*Tj);
+            EXPECT_LT(acc_peak, a - 1e-2);
+        }
+    }
+}
+
+TEST(SCurveTrajectory, BlendingRoundsTheCorners)
+{
+    const double v = 0.5, a = 1.0, J = 5.0;
+    std::vector<KDL::Frame> frames;
+    frames.push_back(KDL::Frame(KDL::Vector(0.5, 0.0, 0.5)));
+    frames.push_back(KDL::Frame(KDL::Vector(0.5, 0.4, 0.5)));
+    frames.push_back(KDL::Frame(KDL::Vector(0.5, 0.4, 0.55)));
+    frames.push_back(KDL::Frame(KDL::Vector(0.3, 0.4, 0.55)));
+    KDLPlanner planner(0.25, 0.5);
+    std::unique_ptr<KDLTrajectory> stop = planner.createSCurveTrajectory(frames, v, a, J, 0.0);
+    std::unique_ptr<KDLTrajectory> blend = planner.createSCurveTrajectory(frames, v, a, J, 0.3);
+    ASSERT_TRUE(stop != NULL && blend != NULL);
+
+    // blended moves may add up to twice the limits, and save time
+    checkSCurve(*stop, v, a, J, 1.0);
+    checkSCurve(*blend, v, a, J, 2.0);
+    EXPECT_LT(blend->duration(), stop->duration());
+    EXPECT_LT((blend->compute(blend->duration()).pos - toEigen(frames[3].p)).norm(), TOL);
+    EXPECT_LT(blend->compute(blend->duration()).vel.norm(), TOL);
+
+    // without blending the trajectory stops on the middle waypoints, with blending it
+    // passes them while moving
+    double t_prev = 0.0;
+    for (unsigned int k = 1; k + 1 < frames.size(); k++)
+    {
+        double t_k = t_prev;
+        for (; t_k < stop->duration(); t_k += 1e-3)
+        {
+            if ((stop->compute(t_k).pos - toEigen(frames[k].p)).norm() < 1e-9) break;
+        }
+        ASSERT_LT(t_k, stop->duration()) << "waypoint " << k;
+        // J*dt^2/2 at most, dt the search step
+        EXPECT_LE(stop->compute(t_k).vel.norm(), 0.5*J*1e-6*(1 + 1e-6)) << "waypoint " << k;
+        t_prev = t_k + 1e-3;
+    }
+    double vel_min = 1e9;
+    for (double t = 0.05*blend->duration(); t < 0.95*blend->duration(); t += 1e-3)
+    {
+        vel_min = std::min(vel_min, blend->compute(t).vel.norm());
+    }
+    EXPECT_GT(vel_min, 1e-3);
+}
+
+TEST(PlannerReplan, StartsFromTheCurrentStateAndStopsAtTheGoal)
+{
+    const double vel = 0.25, acc = 0.5, ang_vel = 0.5, ang_acc = 1.0;
+    KDLPlanner planner = linearPlanner();
+    planner.setOrientation(Eigen::Matrix3d::Identity(), toEigen(KDL::Rotation::RPY(0.3, -0.2, 0.8)));
+    planner.setReplanLimits(vel, acc, ang_vel, ang_acc);
+    std::unique_ptr<KDLTrajectory> traj = planner.createTrajectory("cubic", "linear");
+    ASSERT_TRUE(traj != NULL);
+
+    // from the middle of a move, from rest, and heading to the goal at the speed limit
+    std::vector<trajectory_point> current;
+    current.push_back(traj->compute(2.0));
+    current.push_back(traj->compute(0.0));
+    current.push_back(traj->compute(0.0));
+    current.back().vel = Eigen::Vector3d(0.0, 0.0, vel);
+    KDL::Frame goal(KDL::Rotation::RPY(-0.4, 0.1, 1.2), KDL::Vector(0.4, -0.1, 0.75));
+
+    const double t0 = 10.0, dt = 1e-3;
+    for (unsigned int k = 0; k < current.size(); k++)
+    {
+        SCOPED_TRACE(k);
+        planner.replan(t0, current[k], goal);
+
+        // the same state at the replan time
+        trajectory_point p = planner.sampleOnline(t0);
+        EXPECT_LT((p.pos - current[k].pos).norm(), TOL);
+        EXPECT_LT((p.vel - current[k].vel).norm(), TOL);
+        EXPECT_LT((p.acc - current[k].acc).norm(), TOL);
+        EXPECT_LT((p.rot - current[k].rot).norm(), TOL);
+        EXPECT_LT((p.omega - current[k].omega).norm(), TOL);
+
+        // at rest on the goal after the duration, within the limits up to it; the
+        // duration is the shortest one, so some limit is reached
+        double t = t0, vel_max = 0, acc_max = 0, ang_vel_max = 0, ang_acc_max = 0;
+        for (; t < t0 + 60.0; t += dt)
+        {
+            p = planner.sampleOnline(t);
+            vel_max = std::max(vel_max, p.vel.norm());
+            acc_max = std::max(acc_max, p.acc.norm());
+            ang_vel_max = std::max(ang_vel_max, p.omega.norm());
+            ang_acc_max = std::max(ang_acc_max, p.domega.norm());
+            if ((p.pos - toEigen(goal.p)).norm() < TOL && p.vel.norm() < TOL && p.omega.norm() < TOL) break;
+        }
+        ASSERT_LT(t, t0 + 60.0);
+        p = planner.sampleOnline(t + 1.0);
+        EXPECT_LT((p.pos - toEigen(goal.p)).norm(), TOL);
+        EXPECT_LT((p.rot - toEigen(goal.M)).norm(), TOL);
+        EXPECT_LT(p.vel.norm() + p.acc.norm() + p.omega.norm() + p.domega.norm(), TOL);
+
+        // the limits are checked on a coarser grid than this one
+        EXPECT_LE(vel_max, 1.01*vel);
+        EXPECT_LE(acc_max, 1.01*acc);
+        EXPECT_LE(ang_vel_max, 1.01*ang_vel);
+        EXPECT_LE(ang_acc_max, 1.01*ang_acc);
+        EXPECT_GT(std::max(std::max(vel_max/vel, acc_max/acc), std::max(ang_vel_max/ang_vel, ang_acc_max/ang_acc)), 0.99);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
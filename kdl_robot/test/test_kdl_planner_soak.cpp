@@ -0,0 +1,109 @@
+#include "kdl_ros_control/kdl_planner.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Repeated KDL planning on one planner must keep a flat memory footprint: every
+// operator new and delete in this binary is counted, and the number of live blocks
+// after thousands of plans must be the one after the first few.
+
+static std::atomic<long> g_live(0);
+
+void* operator new(std::size_t size)
+{
+    g_live.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    if (p) g_live.fetch_sub(1, std::memory_order_relaxed);
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    if (p) g_live.fetch_sub(1, std::memory_order_relaxed);
+    std::free(p);
+}
+
+static const int N_CYCLES = 5000;
+
+class PlannerSoakTest : public ::testing::Test
+{
+protected:
+    PlannerSoakTest() : planner_(0.25, 0.5)
+    {
+        frames_.push_back(KDL::Frame(KDL::Vector(0.4, 0.2, 0.6)));
+        frames_.push_back(KDL::Frame(KDL::Rotation::RotZ(0.5), KDL::Vector(0.4, 0.0, 0.5)));
+        frames_.push_back(KDL::Frame(KDL::Rotation::RotZ(1.0), KDL::Vector(0.4, -0.2, 0.6)));
+        F_start_ = KDL::Frame(KDL::Vector(0.4, 0.2, 0.6));
+        centre_ = KDL::Vector(0.4, 0.0, 0.6);
+        base_p_ = KDL::Vector(0.4, 0.0, 0.8);
+        R_end_ = KDL::Rotation::RotZ(0.5);
+    }
+
+    void planFrames()
+    {
+        planner_.CreateTrajectoryFromFrames(frames_, 0.05, 0.05);
+        ASSERT_TRUE(planner_.getTrajectory() != NULL);
+    }
+
+    void planCircle()
+    {
+        planner_.createCircPath(F_start_, centre_, base_p_, R_end_, M_PI/2, 0.05);
+        ASSERT_TRUE(planner_.getTrajectory() != NULL);
+    }
+
+    KDLPlanner planner_;
+    std::vector<KDL::Frame> frames_;
+    KDL::Frame F_start_;
+    KDL::Vector centre_, base_p_;
+    KDL::Rotation R_end_;
+};
+
+TEST_F(PlannerSoakTest, FramesKeepFlatFootprint)
+{
+    planFrames();
+    long live = g_live.load();
+    for (int k = 0; k < N_CYCLES; k++)
+    {
+        planFrames();
+    }
+    EXPECT_EQ(live, g_live.load()) << "live blocks grew over " << N_CYCLES << " plans";
+}
+
+TEST_F(PlannerSoakTest, CircleKeepsFlatFootprint)
+{
+    planCircle();
+    long live = g_live.load();
+    for (int k = 0; k < N_CYCLES; k++)
+    {
+        planCircle();
+    }
+    EXPECT_EQ(live, g_live.load()) << "live blocks grew over " << N_CYCLES << " plans";
+}
+
+TEST_F(PlannerSoakTest, AlternatingPlansKeepFlatFootprint)
+{
+    // each kind releases the trajectory and the path of the other
+    planFrames();
+    planCircle();
+    long live = g_live.load();
+    for (int k = 0; k < N_CYCLES; k++)
+    {
+        planFrames();
+        planCircle();
+    }
+    EXPECT_EQ(live, g_live.load()) << "live blocks grew over " << N_CYCLES << " plan pairs";
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,157 @@
+#include "kdl_ros_control/kdl_qp.h"
+#include "kdl_ros_control/kdl_control.h"
+
+#include "kdl_parser/kdl_parser.hpp"
+#include "urdf/model.h"
+#include <gtest/gtest.h>
+
+#include <random>
+
+// KDLQp on small random problems with box, general and equality (l == u) rows, checked
+// against the KKT conditions, and the row capacity of the QP controller.
+
+#ifndef IIWA14_URDF
+#define IIWA14_URDF "iiwa14.urdf"
+#endif
+
+static const double TOL = 1e-5;
+
+// KKT conditions of x: feasibility, and P*x + q + A^T*y = 0 for multipliers y of the
+// active rows only, y >= 0 on the upper bounds, y <= 0 on the lower ones, free on the
+// equalities
+static void checkKkt(const KDLQp::MatrixN &_P, const KDLQp::VectorN &_q, const KDLQp::Constraints &_A,
+                     const KDLQp::Bounds &_l, const KDLQp::Bounds &_u, const KDLQp::VectorN &_x)
+{
+    int m = _A.rows();
+    Eigen::VectorXd Ax = _A*_x;
+    std::vector<int> active;
+    for (int i = 0; i < m; i++)
+    {
+        EXPECT_GE(Ax(i), _l(i) - TOL) << "row " << i;
+        EXPECT_LE(Ax(i), _u(i) + TOL) << "row " << i;
+        if (Ax(i) < _l(i) + TOL || Ax(i) > _u(i) - TOL) active.push_back(i);
+    }
+    Eigen::MatrixXd A_act(active.size(), KDLQp::N);
+    for (unsigned int k = 0; k < active.size(); k++)
+    {
+        A_act.row(k) = _A.row(active[k]);
+    }
+    Eigen::VectorXd grad = _P*_x + _q;
+    Eigen::VectorXd y = A_act.transpose().colPivHouseholderQr().solve(-grad);
+    EXPECT_LT((grad + A_act.transpose()*y).cwiseAbs().maxCoeff(), 1e3*TOL*(1 + grad.cwiseAbs().maxCoeff()));
+    for (unsigned int k = 0; k < active.size(); k++)
+    {
+        int i = active[k];
+        if (_u(i) - _l(i) < TOL) continue;
+        if (Ax(i) > _u(i) - TOL) EXPECT_GE(y(k), -1e3*TOL) << "row " << i;
+        else EXPECT_LE(y(k), 1e3*TOL) << "row " << i;
+    }
+}
+
+TEST(KDLQp, RandomProblemsSatisfyKkt)
+{
+    std::mt19937 gen(31);
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+    KDLQp qp;
+    qp.setParams(1e-9, 20000);
+    for (int t = 0; t < 50; t++)
+    {
+        KDLQp::MatrixN B;
+        KDLQp::VectorN q, x0;
+        for (int i = 0; i < KDLQp::N; i++)
+        {
+            q(i) = 5*unit(gen);
+            x0(i) = 0.5*unit(gen);
+            for (int j = 0; j < KDLQp::N; j++) B(i,j) = unit(gen);
+        }
+        KDLQp::MatrixN P = B.transpose()*B + 0.1*KDLQp::MatrixN::Identity();
+
+        // box on every variable, three general rows and two equalities, all feasible at x0
+        int m = KDLQp::N + 5;
+        KDLQp::Constraints A(m, KDLQp::N);
+        KDLQp::Bounds l(m), u(m);
+        A.setZero();
+        A.topRows(KDLQp::N).setIdentity();
+        l.head(KDLQp::N).setConstant(-1.0);
+        u.head(KDLQp::N).setConstant(1.0);
+        for (int i = KDLQp::N; i < m; i++)
+        {
+            for (int j = 0; j < KDLQp::N; j++) A(i,j) = unit(gen);
+            double a = A.row(i)*x0;
+            if (i < KDLQp::N + 3)
+            {
+                l(i) = a - 0.5*std::fabs(unit(gen));
+                u(i) = a + 0.5*std::fabs(unit(gen));
+            }
+            else
+            {
+                l(i) = u(i) = a;
+            }
+        }
+
+        KDLQp::VectorN x;
+        qp.resetWarmStart();
+        ASSERT_EQ(KDLQp::SOLVED, qp.solve(P, q, A, l, u, x)) << "problem " << t;
+        SCOPED_TRACE(t);
+        checkKkt(P, q, A, l, u, x);
+        EXPECT_LT((A.bottomRows(2)*x - l.tail(2)).cwiseAbs().maxCoeff(), TOL);
+    }
+}
+
+TEST(KDLQp, UnconstrainedIsTheNewtonStep)
+{
+    std::mt19937 gen(32);
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+    KDLQp::MatrixN B;
+    KDLQp::VectorN q;
+    for (int i = 0; i < KDLQp::N; i++)
+    {
+        q(i) = unit(gen);
+        for (int j = 0; j < KDLQp::N; j++) B(i,j) = unit(gen);
+    }
+    KDLQp::MatrixN P = B.transpose()*B + KDLQp::MatrixN::Identity();
+    KDLQp qp;
+    qp.setParams(1e-10, 2000);
+    KDLQp::VectorN x;
+    ASSERT_EQ(KDLQp::SOLVED, qp.solve(P, q, KDLQp::Constraints(0, KDLQp::N), KDLQp::Bounds(0), KDLQp::Bounds(0), x));
+    EXPECT_LT((x + P.llt().solve(q)).cwiseAbs().maxCoeff(), 1e-6);
+}
+
+TEST(KDLQp, ControllerRejectsRowsBeyondTheCapacity)
+{
+    urdf::Model model;
+    KDL::Tree tree;
+    ASSERT_TRUE(model.initFile(IIWA14_URDF));
+    ASSERT_TRUE(kdl_parser::treeFromUrdfModel(model, tree));
+    KDLRobot robot(tree);
+    robot.addEE(KDL::Frame::Identity());
+    KDLController controller(robot);
+
+    // 7 torque and 7 joint rows, then one per plane
+    int n_planes = KDLQp::MAX_ROWS - 14;
+    for (int k = 0; k < n_planes; k++)
+    {
+        EXPECT_TRUE(controller.addWorkspacePlane(Eigen::Vector3d(0, 0, -1), -0.1*k)) << "plane " << k;
+    }
+    EXPECT_FALSE(controller.addWorkspacePlane(Eigen::Vector3d(0, 0, -1), 0.0));
+
+    // a full QP still solves
+    Eigen::VectorXd q(7);
+    q << 0.1, 0.5, -0.2, -1.2, 0.3, 0.8, 0.0;
+    robot.update(q, Eigen::VectorXd::Zero(7));
+    controller.setQpLimits(Eigen::VectorXd::Constant(7, 100.0), Eigen::VectorXd::Constant(7, 1.0), 0.05);
+    KDL::Frame F = robot.getEEFrame();
+    KDL::Twist V = KDL::Twist::Zero(), A = KDL::Twist::Zero();
+    Eigen::VectorXd tau = controller.qpCntr(F, V, A, 100, 100, 20, 20);
+    ASSERT_EQ(7, tau.size());
+    EXPECT_TRUE(tau.allFinite());
+
+    controller.clearWorkspacePlanes();
+    EXPECT_TRUE(controller.addWorkspacePlane(Eigen::Vector3d(0, 0, -1), 0.0));
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
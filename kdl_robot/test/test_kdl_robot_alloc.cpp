@@ -0,0 +1,119 @@
+#include "kdl_ros_control/kdl_robot.h"
+
+#include "kdl_parser/kdl_parser.hpp"
+#include "urdf/model.h"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <stdexcept>
+
+// Steady-state KDLRobot::update() must not touch the heap: every operator new in
+// this binary is counted and the count must not move across the update calls.
+
+#ifndef IIWA14_URDF
+#define IIWA14_URDF "iiwa14.urdf"
+#endif
+
+static std::atomic<size_t> g_allocs(0);
+
+void* operator new(std::size_t size)
+{
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+class RobotAllocTest : public ::testing::TestWithParam<bool>
+{
+protected:
+    void SetUp()
+    {
+        urdf::Model model;
+        ASSERT_TRUE(model.initFile(IIWA14_URDF));
+        ASSERT_TRUE(kdl_parser::treeFromUrdfModel(model, tree_));
+        robot_ = new KDLRobot(tree_);
+        robot_->addEE(KDL::Frame::Identity());
+        robot_->setFusedDynamics(GetParam());
+
+        std::mt19937 gen(7);
+        std::uniform_real_distribution<double> unit(-1.0, 1.0);
+        Eigen::MatrixXd lim = robot_->getJntLimits();
+        unsigned int n = robot_->getNrJnts();
+        for (unsigned int k = 0; k < 64; k++)
+        {
+            Eigen::VectorXd qk(n), dqk(n);
+            for (unsigned int i = 0; i < n; i++)
+            {
+                qk(i) = 0.9*unit(gen)*lim(i,1);
+                dqk(i) = unit(gen);
+            }
+            q_.push_back(qk);
+            dq_.push_back(dqk);
+            qv_.push_back(std::vector<double>(qk.data(), qk.data() + n));
+            dqv_.push_back(std::vector<double>(dqk.data(), dqk.data() + n));
+        }
+        // warm up, the first call may size KDL internals lazily
+        robot_->update(q_[0], dq_[0]);
+        robot_->update(qv_[0], dqv_[0]);
+    }
+
+    void TearDown()
+    {
+        delete robot_;
+    }
+
+    KDL::Tree tree_;
+    KDLRobot* robot_;
+    std::vector<Eigen::VectorXd> q_, dq_;
+    std::vector<std::vector<double> > qv_, dqv_;
+};
+
+TEST_P(RobotAllocTest, EigenUpdateDoesNotAllocate)
+{
+    size_t allocs = g_allocs.load();
+    for (unsigned int k = 0; k < q_.size(); k++)
+    {
+        robot_->update(q_[k], dq_[k]);
+    }
+    EXPECT_EQ(0u, g_allocs.load() - allocs);
+}
+
+TEST_P(RobotAllocTest, VectorUpdateDoesNotAllocate)
+{
+    size_t allocs = g_allocs.load();
+    for (unsigned int k = 0; k < qv_.size(); k++)
+    {
+        robot_->update(qv_[k], dqv_[k]);
+    }
+    EXPECT_EQ(0u, g_allocs.load() - allocs);
+}
+
+TEST_P(RobotAllocTest, VectorUpdateRejectsWrongSize)
+{
+    std::vector<double> q_short(qv_[0].begin(), qv_[0].end() - 1);
+    EXPECT_THROW(robot_->update(q_short, dqv_[0]), std::invalid_argument);
+    EXPECT_THROW(robot_->update(qv_[0], q_short), std::invalid_argument);
+    // the state of the last good update is kept
+    EXPECT_TRUE(robot_->getJntValues().isApprox(q_[0]));
+}
+
+INSTANTIATE_TEST_CASE_P(Dynamics, RobotAllocTest, ::testing::Values(false, true));
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
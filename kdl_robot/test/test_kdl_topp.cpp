@@ -0,0 +1,217 @@
+#include "kdl_ros_control/kdl_topp.h"
+
+#include "kdl_parser/kdl_parser.hpp"
+#include "urdf/model.h"
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+
+// KDLTopp against the analytic time-optimal law of a straight joint path, the
+// end-effector frame of its Cartesian primitives, and the joint_limits.yaml reader against the MoveIt configuration of the iiwa.
+
+#ifndef IIWA14_URDF
+#define IIWA14_URDF "iiwa14.urdf"
+#endif
+#ifndef IIWA_JOINT_LIMITS
+#define IIWA_JOINT_LIMITS "joint_limits.yaml"
+#endif
+
+TEST(ToppLimits, ParsesMoveItJointLimits)
+{
+    KDLTopp::Limits lim;
+    ASSERT_TRUE(KDLTopp::loadLimits(IIWA_JOINT_LIMITS, 7, lim));
+    ASSERT_EQ(7, lim.max_vel.size());
+    ASSERT_EQ(7, lim.max_acc.size());
+    ASSERT_EQ(7, lim.max_effort.size());
+    for (int j = 0; j < 7; j++)
+    {
+        EXPECT_EQ(10.0, lim.max_vel(j)) << "joint " << j;
+        EXPECT_EQ(0.0, lim.max_acc(j)) << "joint " << j;     // has_acceleration_limits: false
+        EXPECT_EQ(0.0, lim.max_effort(j)) << "joint " << j;
+    }
+
+    // joints identified by order: the count must match
+    EXPECT_FALSE(KDLTopp::loadLimits(IIWA_JOINT_LIMITS, 6, lim));
+    EXPECT_FALSE(KDLTopp::loadLimits("/nonexistent/joint_limits.yaml", 7, lim));
+}
+
+TEST(ToppLimits, ParsesFlagsCommentsAndBlankLines)
+{
+    std::string file = testing::TempDir() + "kdl_topp_limits.yaml";
+    {
+        std::ofstream out(file.c_str());
+        out << "# comment\n"
+               "joint_limits:\n"
+               "  joint_a:\n"
+               "    has_velocity_limits: true\n"
+               "    max_velocity: 1.5\n"
+               "\n"
+               "    # acceleration\n"
+               "    has_acceleration_limits: true\n"
+               "    max_acceleration: 3.25\n"
+               "  joint_b:\n"
+               "    has_velocity_limits: false\n"
+               "    max_velocity: 2\n"
+               "    has_acceleration_limits: true\n"
+               "    max_acceleration: 4\n";
+    }
+    KDLTopp::Limits lim;
+    ASSERT_TRUE(KDLTopp::loadLimits(file, 2, lim));
+    EXPECT_DOUBLE_EQ(1.5, lim.max_vel(0));
+    EXPECT_DOUBLE_EQ(3.25, lim.max_acc(0));
+    EXPECT_EQ(0.0, lim.max_vel(1));                         // has_velocity_limits: false
+    EXPECT_DOUBLE_EQ(4.0, lim.max_acc(1));
+    std::remove(file.c_str());
+}
+
+class ToppTest : public ::testing::Test
+{
+protected:
+    void SetUp()
+    {
+        urdf::Model model;
+        ASSERT_TRUE(model.initFile(IIWA14_URDF));
+        ASSERT_TRUE(kdl_parser::treeFromUrdfModel(model, tree_));
+        robot_ = new KDLRobot(tree_);
+        robot_->addEE(KDL::Frame::Identity());
+    }
+
+    void TearDown()
+    {
+        delete robot_;
+    }
+
+    KDL::Tree tree_;
+    KDLRobot* robot_;
+};
+
+TEST_F(ToppTest, StraightJointPathIsTrapezoid)
+{
+    // q(s) = q0 + s*dq on s in [0,1]: with velocity and acceleration limits only, the
+    // time-optimal law is the trapezoid with sd_max = min vmax_j/|dq_j| and
+    // sdd_max = min amax_j/|dq_j|, of duration 1/sd_max + sd_max/sdd_max
+    const unsigned int n_grid = 400;
+    Eigen::VectorXd q0(7), dq(7);
+    q0 << 0.2, -0.4, 0.1, -1.2, 0.3, 0.8, -0.5;
+    dq << 1.0, 0.5, -0.8, 0.6, -1.5, 0.4, 1.2;
+
+    KDLTopp::Limits lim;
+    lim.max_vel = Eigen::VectorXd::Constant(7, 1.5);
+    lim.max_acc = Eigen::VectorXd::Constant(7, 4.0);
+    lim.max_effort = Eigen::VectorXd::Zero(7);
+    double sd_max = (lim.max_vel.array()/dq.array().abs()).minCoeff();
+    double sdd_max = (lim.max_acc.array()/dq.array().abs()).minCoeff();
+    ASSERT_LT(sd_max*sd_max, sdd_max);                      // reaches the cruise speed
+    double T = 1.0/sd_max + sd_max/sdd_max;
+
+    Eigen::MatrixXd q_path(n_grid + 1, 7);
+    for (unsigned int i = 0; i <= n_grid; i++)
+    {
+        q_path.row(i) = (q0 + double(i)/n_grid*dq).transpose();
+    }
+    KDLTopp topp(*robot_, lim, n_grid);
+    TimeOptimalProfile profile;
+    ASSERT_TRUE(topp.compute(q_path, profile));
+    EXPECT_NEAR(T, profile.duration(), 1e-3*T);
+
+    // the law itself: accelerate, cruise, brake, within the limits
+    double t_acc = sd_max/sdd_max;
+    for (double t = 0.0; t <= profile.duration(); t += 0.01)
+    {
+        double s, sd, sdd;
+        profile.eval(t, s, sd, sdd);
+        double sd_ref = std::min(std::min(sdd_max*t, sd_max), sdd_max*(T - t));
+        EXPECT_NEAR(sd_ref, sd, 2e-2*sd_max) << "t " << t;
+        EXPECT_LE((sd*dq).cwiseAbs().maxCoeff(), 1.5*(1 + 1e-6)) << "t " << t;
+        EXPECT_LE(std::fabs(sdd)*dq.cwiseAbs().maxCoeff(), 4.0*(1 + 1e-6)) << "t " << t;
+        if (t > t_acc + 0.05 && t < T - t_acc - 0.05)
+        {
+            EXPECT_NEAR(sd_max, sd, 1e-6) << "t " << t;
+        }
+    }
+}
+
+TEST_F(ToppTest, TorqueLimitsAreRespected)
+{
+    // same path with torque limits only: the resulting torques stay within them
+    const unsigned int n_grid = 200;
+    Eigen::VectorXd q0(7), dq(7);
+    q0 << 0.0, 0.5, 0.0, -1.0, 0.0, 0.5, 0.0;
+    dq << 0.8, 0.6, -0.5, 0.7, -0.9, 0.4, 1.0;
+    KDLTopp::Limits lim;
+    lim.max_vel = Eigen::VectorXd::Zero(7);
+    lim.max_acc = Eigen::VectorXd::Zero(7);
+    lim.max_effort.resize(7);
+    lim.max_effort << 320, 320, 176, 176, 110, 40, 40;
+
+    Eigen::MatrixXd q_path(n_grid + 1, 7);
+    for (unsigned int i = 0; i <= n_grid; i++)
+    {
+        q_path.row(i) = (q0 + double(i)/n_grid*dq).transpose();
+    }
+    KDLTopp topp(*robot_, lim, n_grid);
+    TimeOptimalProfile profile;
+    ASSERT_TRUE(topp.compute(q_path, profile));
+    ASSERT_GT(profile.duration(), 0.0);
+
+    // the constraints hold at the grid points: tau = M*q'*sdd + C(q,q'*sd)*q'*sd + g with
+    // the speed at the point and the acceleration of the interval that starts there
+    for (unsigned int i = 0; i < n_grid; i++)
+    {
+        Eigen::VectorXd q = q_path.row(i).transpose();
+        robot_->update(q, profile.ds_[i]*dq);
+        Eigen::VectorXd tau = robot_->getJsim()*dq*profile.dds_[i] + robot_->getCoriolis() + robot_->getGravity();
+        EXPECT_LE((tau.cwiseAbs() - lim.max_effort).maxCoeff(), 1e-6*lim.max_effort.maxCoeff())
+            << "s " << profile.s_[i];
+    }
+}
+
+TEST_F(ToppTest, CartesianPathIsOfTheEndEffector)
+{
+    // with an end-effector offset, the joint path of a Cartesian primitive must bring the
+    // end-effector, not the flange, along the path
+    robot_->addEE(KDL::Frame(KDL::Rotation::RPY(0.2, 0.1, -0.3), KDL::Vector(0.0, 0.05, 0.15)));
+    robot_->setAnalyticIk(true);
+    ASSERT_TRUE(robot_->getAnalyticIk());
+    const unsigned int n_grid = 100;
+    Eigen::VectorXd q0(7);
+    q0 << 0.2, 0.6, -0.3, -1.2, 0.4, 0.9, -0.5;
+    robot_->update(q0, Eigen::VectorXd::Zero(7));
+    KDL::Frame F0 = robot_->getEEFrame();
+    LinearPath path(toEigen(F0.p), toEigen(F0.p) + Eigen::Vector3d(0.1, -0.05, 0.08));
+
+    // reference joint path, checked through the end-effector forward kinematics
+    Eigen::MatrixXd q_path(n_grid + 1, 7);
+    KDL::JntArray q(7);
+    q.data = q0;
+    trajectory_point p;
+    for (unsigned int i = 0; i <= n_grid; i++)
+    {
+        path.eval(double(i)/n_grid, 0.0, 0.0, p);
+        KDL::Frame F(F0.M, toKDL(p.pos));
+        q = robot_->getInvKin(q, F*robot_->getFlangeEE().Inverse());
+        robot_->update(q.data, Eigen::VectorXd::Zero(7));
+        ASSERT_TRUE(KDL::Equal(F, robot_->getEEFrame(), 1e-9)) << "s " << double(i)/n_grid;
+        q_path.row(i) = q.data.transpose();
+    }
+
+    KDLTopp::Limits lim;
+    lim.max_vel = Eigen::VectorXd::Constant(7, 1.5);
+    lim.max_acc = Eigen::VectorXd::Constant(7, 4.0);
+    lim.max_effort = Eigen::VectorXd::Zero(7);
+    KDLTopp topp(*robot_, lim, n_grid);
+    TimeOptimalProfile reference, profile;
+    ASSERT_TRUE(topp.compute(q_path, reference));
+    KDL::JntArray seed(7);
+    seed.data = q0;
+    ASSERT_TRUE(topp.compute(path, F0.M, seed, profile));
+    ASSERT_EQ(reference.t_.size(), profile.t_.size());
+    EXPECT_NEAR(reference.duration(), profile.duration(), 1e-12);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}